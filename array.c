@@ -0,0 +1,430 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "array.h"
+#include "bignum.h"
+
+// The kernels process 32 bytes at once with GCCs vector extensions. On x86-64 GCC builds an AVX2
+// and a default (SSE2) version of each kernel and picks the best one when the program starts.
+// Elements that don't fill a whole vector at the end are handled one by one.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#	define KERNEL __attribute__((target_clones("avx2", "default")))
+#else
+#	define KERNEL
+#endif
+
+#define VECTOR_SIZE 32
+typedef int64_t v_i64 __attribute__((vector_size(VECTOR_SIZE)));
+typedef uint64_t v_u64 __attribute__((vector_size(VECTOR_SIZE)));
+typedef double v_f64 __attribute__((vector_size(VECTOR_SIZE)));
+typedef uint8_t v_u8 __attribute__((vector_size(VECTOR_SIZE)));
+#define LANES(type) (VECTOR_SIZE / sizeof(type))
+
+
+//
+// Kernels
+//
+
+// r[i] = a[i] op b[i]
+#define ELEMENTWISE_KERNEL(name, type, vtype, op) \
+	KERNEL static void name(type *r, const type *a, const type *b, size_t n){ \
+		size_t i = 0; \
+		for(; i + LANES(type) <= n; i += LANES(type)){ \
+			vtype x, y; \
+			memcpy(&x, a + i, sizeof(x)); \
+			memcpy(&y, b + i, sizeof(y)); \
+			x = x op y; \
+			memcpy(r + i, &x, sizeof(x)); \
+		} \
+		for(; i < n; i++) \
+			r[i] = a[i] op b[i]; \
+	}
+
+// i64 elements are added and multiplied as unsigned integers. Signed overflows would be undefined
+// behaviour, unsigned ones wrap around (two's complement).
+ELEMENTWISE_KERNEL(add_i64, uint64_t, v_u64, +)
+ELEMENTWISE_KERNEL(add_f64, double, v_f64, +)
+ELEMENTWISE_KERNEL(add_u8, uint8_t, v_u8, +)
+ELEMENTWISE_KERNEL(mul_i64, uint64_t, v_u64, *)
+ELEMENTWISE_KERNEL(mul_f64, double, v_f64, *)
+ELEMENTWISE_KERNEL(mul_u8, uint8_t, v_u8, *)
+
+// Sum of a[i] with one accumulator per lane
+#define SUM_KERNEL(name, type, vtype) \
+	KERNEL static type name(const type *a, size_t n){ \
+		vtype acc = {0}; \
+		size_t i = 0; \
+		for(; i + LANES(type) <= n; i += LANES(type)){ \
+			vtype x; \
+			memcpy(&x, a + i, sizeof(x)); \
+			acc += x; \
+		} \
+		type result = 0; \
+		for(size_t l = 0; l < LANES(type); l++) \
+			result += acc[l]; \
+		for(; i < n; i++) \
+			result += a[i]; \
+		return result; \
+	}
+
+SUM_KERNEL(sum_f64, double, v_f64)
+
+/**
+ * Exact sum of i64 elements without overflows: the upper 32 bits (signed) and the lower 32 bits
+ * (unsigned) of the elements are summed up separately. Neither sum can overflow for up to
+ * SUM_I64_CHUNK elements. The sum is `high * 2^32 + low`.
+ */
+#define SUM_I64_CHUNK ((size_t)1 << 30)
+KERNEL static void sum_i64_parts(const int64_t *a, size_t n, int64_t *high, int64_t *low){
+	v_i64 acc_high = {0}, acc_low = {0};
+	size_t i = 0;
+	for(; i + LANES(int64_t) <= n; i += LANES(int64_t)){
+		v_i64 x;
+		memcpy(&x, a + i, sizeof(x));
+		acc_high += x >> 32;
+		acc_low += x & 0xffffffff;
+	}
+	*high = *low = 0;
+	for(size_t l = 0; l < LANES(int64_t); l++){
+		*high += acc_high[l];
+		*low += acc_low[l];
+	}
+	for(; i < n; i++){
+		*high += a[i] >> 32;
+		*low += a[i] & 0xffffffff;
+	}
+}
+
+// Sum of a[i] * b[i]
+#define DOT_KERNEL(name, type, vtype) \
+	KERNEL static type name(const type *a, const type *b, size_t n){ \
+		vtype acc = {0}; \
+		size_t i = 0; \
+		for(; i + LANES(type) <= n; i += LANES(type)){ \
+			vtype x, y; \
+			memcpy(&x, a + i, sizeof(x)); \
+			memcpy(&y, b + i, sizeof(y)); \
+			acc += x * y; \
+		} \
+		type result = 0; \
+		for(size_t l = 0; l < LANES(type); l++) \
+			result += acc[l]; \
+		for(; i < n; i++) \
+			result += a[i] * b[i]; \
+		return result; \
+	}
+
+// Only used for i64 elements if the result can't overflow (see array_dot()). Computed unsigned
+// so the intermediate sums of the lanes can't be undefined behaviour.
+DOT_KERNEL(dot_i64, uint64_t, v_u64)
+DOT_KERNEL(dot_f64, double, v_f64)
+
+// Bytes are summed up in 64 bit so they can't overflow. Kept simple and left to the auto vectorizer.
+KERNEL static uint64_t sum_u8(const uint8_t *a, size_t n){
+	uint64_t result = 0;
+	for(size_t i = 0; i < n; i++)
+		result += a[i];
+	return result;
+}
+
+KERNEL static uint64_t dot_u8(const uint8_t *a, const uint8_t *b, size_t n){
+	uint64_t result = 0;
+	for(size_t i = 0; i < n; i++)
+		result += (uint32_t)a[i] * b[i];
+	return result;
+}
+
+// Minimum (cmp is <) or maximum (cmp is >) of n > 0 elements. The vector comparison gives a mask
+// with all bits set in the lanes where it holds. It selects the lanes of x or m without branches.
+#define MINMAX_KERNEL(name, type, vtype, mtype, cmp) \
+	KERNEL static type name(const type *a, size_t n){ \
+		type result = a[0]; \
+		size_t i = 0; \
+		if (n >= LANES(type)) { \
+			vtype m; \
+			memcpy(&m, a, sizeof(m)); \
+			for(i = LANES(type); i + LANES(type) <= n; i += LANES(type)){ \
+				vtype x; \
+				memcpy(&x, a + i, sizeof(x)); \
+				mtype mask = (x cmp m); \
+				m = (vtype)( ((mtype)x & mask) | ((mtype)m & ~mask) ); \
+			} \
+			result = m[0]; \
+			for(size_t l = 1; l < LANES(type); l++) \
+				if (m[l] cmp result) \
+					result = m[l]; \
+		} \
+		for(; i < n; i++) \
+			if (a[i] cmp result) \
+				result = a[i]; \
+		return result; \
+	}
+
+MINMAX_KERNEL(min_i64, int64_t, v_i64, v_i64, <)
+MINMAX_KERNEL(max_i64, int64_t, v_i64, v_i64, >)
+MINMAX_KERNEL(min_f64, double, v_f64, v_i64, <)
+MINMAX_KERNEL(max_f64, double, v_f64, v_i64, >)
+
+KERNEL static uint8_t min_u8(const uint8_t *a, size_t n){
+	uint8_t result = a[0];
+	for(size_t i = 1; i < n; i++)
+		result = (a[i] < result) ? a[i] : result;
+	return result;
+}
+
+KERNEL static uint8_t max_u8(const uint8_t *a, size_t n){
+	uint8_t result = a[0];
+	for(size_t i = 1; i < n; i++)
+		result = (a[i] > result) ? a[i] : result;
+	return result;
+}
+
+// Copies the elements for which `a[i] cmp value` holds to r and returns their number. Every
+// element is written and the target index only advances if it matched, so there are no branches
+// that depend on the data.
+#define FILTER_KERNEL(name, type, value_type, cmp) \
+	static size_t name(type *r, const type *a, size_t n, value_type value){ \
+		size_t count = 0; \
+		for(size_t i = 0; i < n; i++){ \
+			r[count] = a[i]; \
+			count += (a[i] cmp value); \
+		} \
+		return count; \
+	}
+
+FILTER_KERNEL(filter_eq_i64, int64_t, int64_t, ==)
+FILTER_KERNEL(filter_lt_i64, int64_t, int64_t, <)
+FILTER_KERNEL(filter_gt_i64, int64_t, int64_t, >)
+FILTER_KERNEL(filter_eq_f64, double, double, ==)
+FILTER_KERNEL(filter_lt_f64, double, double, <)
+FILTER_KERNEL(filter_gt_f64, double, double, >)
+FILTER_KERNEL(filter_eq_u8, uint8_t, int64_t, ==)
+FILTER_KERNEL(filter_lt_u8, uint8_t, int64_t, <)
+FILTER_KERNEL(filter_gt_u8, uint8_t, int64_t, >)
+
+
+//
+// Array atoms
+//
+
+size_t array_element_size(uint8_t kind){
+	switch(kind){
+		case ARRAY_I64: return sizeof(int64_t);
+		case ARRAY_F64: return sizeof(double);
+		case ARRAY_U8: return sizeof(uint8_t);
+	}
+	assert(0);
+	return 0;
+}
+
+/**
+ * Allocates an array with `length` elements, all set to 0.
+ */
+atom_t* array_new(uint8_t kind, size_t length){
+	size_t size = length * array_element_size(kind);
+	void *data = gc_alloc_atomic(size);
+	memset(data, 0, size);
+	return array_atom_alloc(kind, data, length);
+}
+
+/**
+ * Returns the element at `index` as a number atom. The index has to be in range.
+ */
+atom_t* array_get(atom_t *array, size_t index){
+	assert(array->type == T_ARRAY && index < array->array.length);
+	switch(array->array.kind){
+		case ARRAY_I64: return num_atom_alloc( ((int64_t*)array->array.data)[index] );
+		case ARRAY_F64: return float_atom_alloc( ((double*)array->array.data)[index] );
+		case ARRAY_U8: return num_atom_alloc( ((uint8_t*)array->array.data)[index] );
+	}
+	assert(0);
+	return nil_atom();
+}
+
+/**
+ * Stores `value` at `index`. Returns false if the value can't be stored in the array: i64 arrays
+ * take integers, f64 arrays all numbers and u8 arrays integers from 0 to 255.
+ */
+bool array_set(atom_t *array, size_t index, atom_t *value){
+	assert(array->type == T_ARRAY && index < array->array.length);
+	switch(array->array.kind){
+		case ARRAY_I64:
+			if (value->type != T_NUM)
+				return false;
+			((int64_t*)array->array.data)[index] = value->num;
+			return true;
+		case ARRAY_F64:
+			if ( !is_num_atom(value) )
+				return false;
+			((double*)array->array.data)[index] = num_to_double(value);
+			return true;
+		case ARRAY_U8:
+			if (value->type != T_NUM || value->num < 0 || value->num > UINT8_MAX)
+				return false;
+			((uint8_t*)array->array.data)[index] = value->num;
+			return true;
+	}
+	return false;
+}
+
+atom_t* array_add(atom_t *a, atom_t *b){
+	assert(a->array.kind == b->array.kind && a->array.length == b->array.length);
+	atom_t *result = array_new(a->array.kind, a->array.length);
+	switch(a->array.kind){
+		case ARRAY_I64: add_i64(result->array.data, a->array.data, b->array.data, a->array.length); break;
+		case ARRAY_F64: add_f64(result->array.data, a->array.data, b->array.data, a->array.length); break;
+		case ARRAY_U8: add_u8(result->array.data, a->array.data, b->array.data, a->array.length); break;
+	}
+	return result;
+}
+
+atom_t* array_mul(atom_t *a, atom_t *b){
+	assert(a->array.kind == b->array.kind && a->array.length == b->array.length);
+	atom_t *result = array_new(a->array.kind, a->array.length);
+	switch(a->array.kind){
+		case ARRAY_I64: mul_i64(result->array.data, a->array.data, b->array.data, a->array.length); break;
+		case ARRAY_F64: mul_f64(result->array.data, a->array.data, b->array.data, a->array.length); break;
+		case ARRAY_U8: mul_u8(result->array.data, a->array.data, b->array.data, a->array.length); break;
+	}
+	return result;
+}
+
+// Converts `high * 2^32 + low` into a number atom, a bignum if it doesn't fit into an int64_t
+static atom_t* combine_parts(atom_t *high, int64_t low){
+	return num_add( num_mul(high, num_atom_alloc((int64_t)1 << 32)), num_atom_alloc(low) );
+}
+
+static atom_t* int128_atom(__int128 value){
+	atom_t *top = num_atom_alloc(value >> 64);
+	atom_t *middle = combine_parts(top, (value >> 32) & 0xffffffff);
+	return combine_parts(middle, value & 0xffffffff);
+}
+
+static uint64_t max_abs_i64(const int64_t *a, size_t n){
+	int64_t min = min_i64(a, n), max = max_i64(a, n);
+	uint64_t min_abs = (min < 0) ? -(uint64_t)min : (uint64_t)min;
+	return (min_abs > (uint64_t)max) ? min_abs : (uint64_t)max;
+}
+
+/**
+ * Exact dot product of i64 arrays. If the largest possible result fits into an int64_t the
+ * vectorized kernel is used. Otherwise the products are summed up in 128 bit and the result is
+ * promoted to a bignum when needed.
+ */
+static atom_t* dot_i64_exact(const int64_t *a, const int64_t *b, size_t n){
+	if (n == 0)
+		return num_atom_alloc(0);
+	
+	uint64_t bound;
+	if ( !__builtin_mul_overflow(max_abs_i64(a, n), max_abs_i64(b, n), &bound) && !__builtin_mul_overflow(bound, n, &bound) && bound <= INT64_MAX )
+		return num_atom_alloc( (int64_t)dot_i64((const uint64_t*)a, (const uint64_t*)b, n) );
+	
+	atom_t *result = num_atom_alloc(0);
+	__int128 acc = 0;
+	for(size_t i = 0; i < n; i++){
+		__int128 product = (__int128)a[i] * b[i];
+		__int128 sum;
+		if ( __builtin_add_overflow(acc, product, &sum) ) {
+			result = num_add(result, int128_atom(acc));
+			sum = product;
+		}
+		acc = sum;
+	}
+	return num_add(result, int128_atom(acc));
+}
+
+atom_t* array_dot(atom_t *a, atom_t *b){
+	assert(a->array.kind == b->array.kind && a->array.length == b->array.length);
+	switch(a->array.kind){
+		case ARRAY_I64: return dot_i64_exact(a->array.data, b->array.data, a->array.length);
+		case ARRAY_F64: return float_atom_alloc( dot_f64(a->array.data, b->array.data, a->array.length) );
+		case ARRAY_U8: return num_atom_alloc( dot_u8(a->array.data, b->array.data, a->array.length) );
+	}
+	return nil_atom();
+}
+
+atom_t* array_sum(atom_t *array){
+	switch(array->array.kind){
+		case ARRAY_I64: {
+			const int64_t *data = array->array.data;
+			atom_t *result = num_atom_alloc(0);
+			for(size_t start = 0; start < array->array.length; start += SUM_I64_CHUNK){
+				size_t n = array->array.length - start;
+				int64_t high, low;
+				sum_i64_parts(data + start, (n < SUM_I64_CHUNK) ? n : SUM_I64_CHUNK, &high, &low);
+				result = num_add(result, combine_parts(num_atom_alloc(high), low));
+			}
+			return result;
+			}
+		case ARRAY_F64: return float_atom_alloc( sum_f64(array->array.data, array->array.length) );
+		case ARRAY_U8: return num_atom_alloc( sum_u8(array->array.data, array->array.length) );
+	}
+	return nil_atom();
+}
+
+atom_t* array_min(atom_t *array){
+	if (array->array.length == 0)
+		return nil_atom();
+	switch(array->array.kind){
+		case ARRAY_I64: return num_atom_alloc( min_i64(array->array.data, array->array.length) );
+		case ARRAY_F64: return float_atom_alloc( min_f64(array->array.data, array->array.length) );
+		case ARRAY_U8: return num_atom_alloc( min_u8(array->array.data, array->array.length) );
+	}
+	return nil_atom();
+}
+
+atom_t* array_max(atom_t *array){
+	if (array->array.length == 0)
+		return nil_atom();
+	switch(array->array.kind){
+		case ARRAY_I64: return num_atom_alloc( max_i64(array->array.data, array->array.length) );
+		case ARRAY_F64: return float_atom_alloc( max_f64(array->array.data, array->array.length) );
+		case ARRAY_U8: return num_atom_alloc( max_u8(array->array.data, array->array.length) );
+	}
+	return nil_atom();
+}
+
+/**
+ * Returns a new array with the elements for which `element op value` holds. Returns NULL if
+ * `value` can't be compared with the elements (i64 and u8 arrays need an integer).
+ */
+atom_t* array_filter(atom_t *array, uint8_t op, atom_t *value){
+	size_t length = array->array.length, count = 0;
+	atom_t *result = array_new(array->array.kind, length);
+	void *r = result->array.data, *a = array->array.data;
+	
+	switch(array->array.kind){
+		case ARRAY_I64:
+		case ARRAY_U8:
+			if (value->type != T_NUM)
+				return NULL;
+			if (array->array.kind == ARRAY_I64) {
+				switch(op){
+					case BC_EQ: count = filter_eq_i64(r, a, length, value->num); break;
+					case BC_LT: count = filter_lt_i64(r, a, length, value->num); break;
+					case BC_GT: count = filter_gt_i64(r, a, length, value->num); break;
+				}
+			} else {
+				switch(op){
+					case BC_EQ: count = filter_eq_u8(r, a, length, value->num); break;
+					case BC_LT: count = filter_lt_u8(r, a, length, value->num); break;
+					case BC_GT: count = filter_gt_u8(r, a, length, value->num); break;
+				}
+			}
+			break;
+		case ARRAY_F64: {
+			if ( !is_num_atom(value) )
+				return NULL;
+			double threshold = num_to_double(value);
+			switch(op){
+				case BC_EQ: count = filter_eq_f64(r, a, length, threshold); break;
+				case BC_LT: count = filter_lt_f64(r, a, length, threshold); break;
+				case BC_GT: count = filter_gt_f64(r, a, length, threshold); break;
+			}
+			} break;
+	}
+	
+	result->array.length = count;
+	return result;
+}
\ No newline at end of file
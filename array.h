@@ -0,0 +1,36 @@
+#ifndef _ARRAY_H
+#define _ARRAY_H
+
+/**
+ * Typed arrays (T_ARRAY atoms) store their elements unboxed as int64_t, double or uint8_t. The
+ * elements are only boxed into atoms when they're read one by one. The operations on whole
+ * arrays work on the unboxed data and use vectorized kernels.
+ *
+ * Elementwise addition and multiplication of i64 and u8 elements wraps around (two's
+ * complement). Sums and dot products of i64 arrays are exact and switch to bignums if needed.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "memory.h"
+#include "bytecode.h"
+
+size_t array_element_size(uint8_t kind);
+atom_t* array_new(uint8_t kind, size_t length);
+atom_t* array_get(atom_t *array, size_t index);
+bool array_set(atom_t *array, size_t index, atom_t *value);
+
+// Elementwise operations, both arrays must have the same kind and length
+atom_t* array_add(atom_t *a, atom_t *b);
+atom_t* array_mul(atom_t *a, atom_t *b);
+atom_t* array_dot(atom_t *a, atom_t *b);
+
+// Reductions, min and max return nil for empty arrays
+atom_t* array_sum(atom_t *array);
+atom_t* array_min(atom_t *array);
+atom_t* array_max(atom_t *array);
+
+// `op` is BC_EQ, BC_LT or BC_GT, the elements are compared with `value`
+atom_t* array_filter(atom_t *array, uint8_t op, atom_t *value);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,505 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "bignum.h"
+
+// Below this number of digits the schoolbook multiplication is faster than Karatsuba
+#define KARATSUBA_THRESHOLD 32
+// Largest power of 10 that fits into one digit, used to convert from and to decimal strings
+#define DECIMAL_BASE 1000000000
+#define DECIMAL_BASE_DIGITS 9
+
+
+//
+// Magnitude functions. They work on plain digit arrays, the least significant digit first.
+//
+
+static size_t mag_normalize(const uint32_t *a, size_t length){
+	while (length > 0 && a[length-1] == 0)
+		length--;
+	return length;
+}
+
+static int mag_cmp(const uint32_t *a, size_t a_length, const uint32_t *b, size_t b_length){
+	if (a_length != b_length)
+		return (a_length < b_length) ? -1 : 1;
+	for(size_t i = a_length; i > 0; i--){
+		if (a[i-1] != b[i-1])
+			return (a[i-1] < b[i-1]) ? -1 : 1;
+	}
+	return 0;
+}
+
+/**
+ * r = a + b. `r` needs room for max(a_length, b_length) + 1 digits and can be the same as `a`.
+ * Returns the normalized length of the result.
+ */
+static size_t mag_add(uint32_t *r, const uint32_t *a, size_t a_length, const uint32_t *b, size_t b_length){
+	if (a_length < b_length) {
+		const uint32_t *t = a; a = b; b = t;
+		size_t tl = a_length; a_length = b_length; b_length = tl;
+	}
+	
+	uint64_t carry = 0;
+	for(size_t i = 0; i < a_length; i++){
+		uint64_t sum = (uint64_t)a[i] + (i < b_length ? b[i] : 0) + carry;
+		r[i] = (uint32_t)sum;
+		carry = sum >> 32;
+	}
+	r[a_length] = carry;
+	return mag_normalize(r, a_length + 1);
+}
+
+/**
+ * r = a - b with a >= b. `r` needs room for a_length digits and can be the same as `a`. Returns
+ * the normalized length of the result.
+ */
+static size_t mag_sub(uint32_t *r, const uint32_t *a, size_t a_length, const uint32_t *b, size_t b_length){
+	int64_t borrow = 0;
+	for(size_t i = 0; i < a_length; i++){
+		int64_t diff = (int64_t)a[i] - (i < b_length ? b[i] : 0) - borrow;
+		borrow = (diff < 0);
+		r[i] = (uint32_t)(diff + (borrow << 32));
+	}
+	assert(borrow == 0);
+	return mag_normalize(r, a_length);
+}
+
+/**
+ * r = a * b. `r` needs room for a_length + b_length digits and must not overlap with `a` or `b`.
+ * All digits of `r` are overwritten.
+ *
+ * Large operands are multiplied with the Karatsuba algorithm. Both are split at m digits into
+ * a = a1 * B^m + a0 and b = b1 * B^m + b0. Then
+ *
+ * 	a * b = z2 * B^2m + z1 * B^m + z0
+ * 	z0 = a0 * b0, z2 = a1 * b1, z1 = (a0 + a1) * (b0 + b1) - z0 - z2
+ *
+ * needs only three instead of four multiplications of half the size.
+ */
+static void mag_mul(uint32_t *r, const uint32_t *a, size_t a_length, const uint32_t *b, size_t b_length){
+	if (a_length < KARATSUBA_THRESHOLD || b_length < KARATSUBA_THRESHOLD) {
+		memset(r, 0, (a_length + b_length) * sizeof(r[0]));
+		for(size_t i = 0; i < a_length; i++){
+			uint64_t carry = 0;
+			for(size_t j = 0; j < b_length; j++){
+				uint64_t t = (uint64_t)a[i] * b[j] + r[i+j] + carry;
+				r[i+j] = (uint32_t)t;
+				carry = t >> 32;
+			}
+			r[i+b_length] = carry;
+		}
+		return;
+	}
+	
+	size_t m = ((a_length > b_length) ? a_length : b_length) / 2;
+	size_t a0_length = (a_length < m) ? a_length : m, a1_length = a_length - a0_length;
+	size_t b0_length = (b_length < m) ? b_length : m, b1_length = b_length - b0_length;
+	
+	// z0 and z2 go directly into their place in r, they don't overlap
+	memset(r, 0, (a_length + b_length) * sizeof(r[0]));
+	mag_mul(r, a, a0_length, b, b0_length);
+	if (a1_length > 0 && b1_length > 0)
+		mag_mul(r + 2*m, a + m, a1_length, b + m, b1_length);
+	
+	// The upper halves can have m + 1 digits, the sums one more
+	uint32_t *a_sum = gc_alloc_atomic((m + 2) * sizeof(uint32_t));
+	uint32_t *b_sum = gc_alloc_atomic((m + 2) * sizeof(uint32_t));
+	size_t a_sum_length = mag_add(a_sum, a, a0_length, a + m, a1_length);
+	size_t b_sum_length = mag_add(b_sum, b, b0_length, b + m, b1_length);
+	
+	size_t z1_length = a_sum_length + b_sum_length;
+	uint32_t *z1 = gc_alloc_atomic((z1_length + 1) * sizeof(uint32_t));
+	mag_mul(z1, a_sum, a_sum_length, b_sum, b_sum_length);
+	z1_length = mag_normalize(z1, z1_length);
+	z1_length = mag_sub(z1, z1, z1_length, r, mag_normalize(r, a0_length + b0_length));
+	z1_length = mag_sub(z1, z1, z1_length, r + 2*m, mag_normalize(r + 2*m, a_length + b_length - 2*m));
+	
+	// Add z1 * B^m, the result fits into a_length + b_length digits so the carry stops in time
+	uint64_t carry = 0;
+	for(size_t i = m; i < a_length + b_length && (i - m < z1_length || carry); i++){
+		uint64_t sum = (uint64_t)r[i] + (i - m < z1_length ? z1[i - m] : 0) + carry;
+		r[i] = (uint32_t)sum;
+		carry = sum >> 32;
+	}
+	
+	gc_free(a_sum);
+	gc_free(b_sum);
+	gc_free(z1);
+}
+
+/**
+ * Divides `u` by `v` (Knuth's algorithm D). `q` needs room for u_length - v_length + 1 digits
+ * and `r` for v_length digits. Requires u_length >= v_length >= 2 and a normalized `v`.
+ */
+static void mag_divmod(uint32_t *q, uint32_t *r, const uint32_t *u, size_t u_length, const uint32_t *v, size_t v_length){
+	size_t m = u_length, n = v_length;
+	
+	// Shift both so the highest bit of the divisor is set, this keeps the estimates of the
+	// quotient digits at most 2 off.
+	int s = __builtin_clz(v[n-1]);
+	uint32_t *vn = gc_alloc_atomic(n * sizeof(uint32_t));
+	uint32_t *un = gc_alloc_atomic((m + 1) * sizeof(uint32_t));
+	for(size_t i = n - 1; i > 0; i--)
+		vn[i] = (v[i] << s) | (uint32_t)((uint64_t)v[i-1] >> (32 - s));
+	vn[0] = v[0] << s;
+	un[m] = (uint32_t)((uint64_t)u[m-1] >> (32 - s));
+	for(size_t i = m - 1; i > 0; i--)
+		un[i] = (u[i] << s) | (uint32_t)((uint64_t)u[i-1] >> (32 - s));
+	un[0] = u[0] << s;
+	
+	for(ssize_t j = m - n; j >= 0; j--){
+		uint64_t numerator = ((uint64_t)un[j+n] << 32) | un[j+n-1];
+		uint64_t qhat = numerator / vn[n-1], rhat = numerator % vn[n-1];
+		while ( qhat > UINT32_MAX || qhat * vn[n-2] > ((rhat << 32) | un[j+n-2]) ) {
+			qhat--;
+			rhat += vn[n-1];
+			if (rhat > UINT32_MAX)
+				break;
+		}
+		
+		// Multiply and subtract
+		int64_t borrow = 0, t;
+		for(size_t i = 0; i < n; i++){
+			uint64_t p = qhat * vn[i];
+			t = (int64_t)un[i+j] - borrow - (int64_t)(p & UINT32_MAX);
+			un[i+j] = (uint32_t)t;
+			borrow = (int64_t)(p >> 32) - (t >> 32);
+		}
+		t = (int64_t)un[j+n] - borrow;
+		un[j+n] = (uint32_t)t;
+		
+		// Subtracted too much, add one divisor back
+		q[j] = (uint32_t)qhat;
+		if (t < 0) {
+			q[j]--;
+			uint64_t carry = 0;
+			for(size_t i = 0; i < n; i++){
+				uint64_t sum = (uint64_t)un[i+j] + vn[i] + carry;
+				un[i+j] = (uint32_t)sum;
+				carry = sum >> 32;
+			}
+			un[j+n] += carry;
+		}
+	}
+	
+	for(size_t i = 0; i < n - 1; i++)
+		r[i] = (un[i] >> s) | (uint32_t)((uint64_t)un[i+1] << (32 - s));
+	r[n-1] = un[n-1] >> s;
+	
+	gc_free(vn);
+	gc_free(un);
+}
+
+/**
+ * q = a / d for a single digit divisor. `q` can be the same as `a`. Returns the remainder.
+ */
+static uint32_t mag_divmod_digit(uint32_t *q, const uint32_t *a, size_t a_length, uint32_t d){
+	uint64_t remainder = 0;
+	for(size_t i = a_length; i > 0; i--){
+		uint64_t t = (remainder << 32) | a[i-1];
+		q[i-1] = t / d;
+		remainder = t % d;
+	}
+	return remainder;
+}
+
+
+//
+// Bignums
+//
+
+static bignum_t* bignum_alloc(size_t length){
+	bignum_t *value = gc_alloc_atomic(sizeof(bignum_t) + length * sizeof(uint32_t));
+	value->negative = false;
+	value->length = length;
+	memset(value->digits, 0, length * sizeof(uint32_t));
+	return value;
+}
+
+bignum_t* bignum_from_int(int64_t value){
+	uint64_t magnitude = (value < 0) ? -(uint64_t)value : (uint64_t)value;
+	bignum_t *result = bignum_alloc(2);
+	result->negative = (value < 0);
+	result->digits[0] = (uint32_t)magnitude;
+	result->digits[1] = magnitude >> 32;
+	result->length = mag_normalize(result->digits, 2);
+	return result;
+}
+
+/**
+ * Stores the value in `result` if it fits into an int64_t. Returns false if it doesn't.
+ */
+bool bignum_to_int(bignum_t *value, int64_t *result){
+	if (value->length > 2)
+		return false;
+	
+	uint64_t magnitude = 0;
+	for(size_t i = value->length; i > 0; i--)
+		magnitude = (magnitude << 32) | value->digits[i-1];
+	
+	if (!value->negative && magnitude <= INT64_MAX) {
+		*result = magnitude;
+		return true;
+	} else if (value->negative && magnitude <= (uint64_t)INT64_MAX + 1) {
+		*result = -(int64_t)(magnitude - 1) - 1;
+		return true;
+	}
+	return false;
+}
+
+double bignum_to_double(bignum_t *value){
+	double result = 0;
+	for(size_t i = value->length; i > 0; i--)
+		result = result * 4294967296.0 + value->digits[i-1];
+	return value->negative ? -result : result;
+}
+
+/**
+ * Parses a decimal number with an optional leading minus sign.
+ */
+bignum_t* bignum_from_str(const char *str){
+	bool negative = (*str == '-');
+	if (negative)
+		str++;
+	
+	size_t str_length = strlen(str);
+	bignum_t *result = bignum_alloc(str_length / DECIMAL_BASE_DIGITS + 1);
+	size_t length = 0;
+	
+	// Add the decimal digits in chunks of up to 9 digits: result = result * 10^k + chunk
+	for(size_t pos = 0; pos < str_length; ){
+		size_t chunk_length = (str_length - pos) % DECIMAL_BASE_DIGITS;
+		if (chunk_length == 0)
+			chunk_length = DECIMAL_BASE_DIGITS;
+		
+		uint32_t chunk = 0, factor = 1;
+		for(size_t i = 0; i < chunk_length; i++, pos++){
+			chunk = chunk * 10 + (str[pos] - '0');
+			factor *= 10;
+		}
+		
+		uint64_t carry = chunk;
+		for(size_t i = 0; i < length; i++){
+			uint64_t t = (uint64_t)result->digits[i] * factor + carry;
+			result->digits[i] = (uint32_t)t;
+			carry = t >> 32;
+		}
+		if (carry)
+			result->digits[length++] = carry;
+	}
+	
+	result->length = mag_normalize(result->digits, length);
+	result->negative = negative && result->length > 0;
+	return result;
+}
+
+/**
+ * Returns the decimal representation of `value`. The string is allocated with gc_alloc().
+ */
+char* bignum_to_str(bignum_t *value){
+	// Each digit has at most 10 decimal digits, plus sign and zero terminator
+	size_t size = value->length * 10 + 2;
+	char *str = gc_alloc(size);
+	char *pos = str + size - 1;
+	*pos = '\0';
+	
+	uint32_t *rest = gc_alloc_atomic(value->length * sizeof(uint32_t) + 1);
+	memcpy(rest, value->digits, value->length * sizeof(uint32_t));
+	size_t length = value->length;
+	
+	// Split off chunks of 9 decimal digits starting at the least significant one
+	do {
+		uint32_t chunk = mag_divmod_digit(rest, rest, length, DECIMAL_BASE);
+		length = mag_normalize(rest, length);
+		for(size_t i = 0; i < DECIMAL_BASE_DIGITS && (length > 0 || chunk > 0 || i == 0); i++){
+			*(--pos) = '0' + chunk % 10;
+			chunk /= 10;
+		}
+	} while (length > 0);
+	
+	if (value->negative)
+		*(--pos) = '-';
+	
+	gc_free(rest);
+	memmove(str, pos, str + size - pos);
+	return str;
+}
+
+int bignum_cmp(bignum_t *a, bignum_t *b){
+	if (a->negative != b->negative)
+		return a->negative ? -1 : 1;
+	int result = mag_cmp(a->digits, a->length, b->digits, b->length);
+	return a->negative ? -result : result;
+}
+
+/**
+ * Adds `a` and `b` with the sign of `b` flipped if `negate_b` is set. Used for addition
+ * and subtraction.
+ */
+static bignum_t* bignum_add_signed(bignum_t *a, bignum_t *b, bool negate_b){
+	bool b_negative = b->negative ^ negate_b;
+	bignum_t *result = bignum_alloc( ((a->length > b->length) ? a->length : b->length) + 1 );
+	
+	if (a->negative == b_negative) {
+		result->length = mag_add(result->digits, a->digits, a->length, b->digits, b->length);
+		result->negative = a->negative;
+	} else if ( mag_cmp(a->digits, a->length, b->digits, b->length) >= 0 ) {
+		result->length = mag_sub(result->digits, a->digits, a->length, b->digits, b->length);
+		result->negative = a->negative;
+	} else {
+		result->length = mag_sub(result->digits, b->digits, b->length, a->digits, a->length);
+		result->negative = b_negative;
+	}
+	
+	if (result->length == 0)
+		result->negative = false;
+	return result;
+}
+
+bignum_t* bignum_add(bignum_t *a, bignum_t *b){
+	return bignum_add_signed(a, b, false);
+}
+
+bignum_t* bignum_sub(bignum_t *a, bignum_t *b){
+	return bignum_add_signed(a, b, true);
+}
+
+bignum_t* bignum_mul(bignum_t *a, bignum_t *b){
+	if (a->length == 0 || b->length == 0)
+		return bignum_alloc(0);
+	
+	bignum_t *result = bignum_alloc(a->length + b->length);
+	mag_mul(result->digits, a->digits, a->length, b->digits, b->length);
+	result->length = mag_normalize(result->digits, result->length);
+	result->negative = a->negative != b->negative;
+	return result;
+}
+
+/**
+ * Returns a / b rounded towards zero, like the C division. If `remainder` isn't NULL it gets
+ * a % b (with the sign of `a`). `b` must not be zero.
+ */
+bignum_t* bignum_div(bignum_t *a, bignum_t *b, bignum_t **remainder){
+	assert(b->length > 0);
+	
+	bignum_t *quotient, *rest;
+	if ( mag_cmp(a->digits, a->length, b->digits, b->length) < 0 ) {
+		quotient = bignum_alloc(0);
+		rest = bignum_alloc(a->length);
+		memcpy(rest->digits, a->digits, a->length * sizeof(uint32_t));
+	} else if (b->length == 1) {
+		quotient = bignum_alloc(a->length);
+		rest = bignum_alloc(1);
+		rest->digits[0] = mag_divmod_digit(quotient->digits, a->digits, a->length, b->digits[0]);
+	} else {
+		quotient = bignum_alloc(a->length - b->length + 1);
+		rest = bignum_alloc(b->length);
+		mag_divmod(quotient->digits, rest->digits, a->digits, a->length, b->digits, b->length);
+	}
+	
+	quotient->length = mag_normalize(quotient->digits, quotient->length);
+	quotient->negative = (a->negative != b->negative) && quotient->length > 0;
+	if (remainder) {
+		rest->length = mag_normalize(rest->digits, rest->length);
+		rest->negative = a->negative && rest->length > 0;
+		*remainder = rest;
+	}
+	return quotient;
+}
+
+
+//
+// Number atoms
+//
+
+static bignum_t* to_bignum(atom_t *atom){
+	assert(atom->type == T_NUM || atom->type == T_BIGNUM);
+	return (atom->type == T_NUM) ? bignum_from_int(atom->num) : atom->bignum;
+}
+
+double num_to_double(atom_t *atom){
+	switch(atom->type){
+		case T_NUM:
+			return atom->num;
+		case T_FLOAT:
+			return atom->real;
+		default:
+			return bignum_to_double(to_bignum(atom));
+	}
+}
+
+/**
+ * Returns a T_NUM atom if `value` fits into an int64_t, a T_BIGNUM atom otherwise.
+ */
+atom_t* num_atom_from_bignum(bignum_t *value){
+	int64_t small;
+	if ( bignum_to_int(value, &small) )
+		return num_atom_alloc(small);
+	return bignum_atom_alloc(value);
+}
+
+atom_t* num_add(atom_t *a, atom_t *b){
+	int64_t result;
+	if ( a->type == T_NUM && b->type == T_NUM && !__builtin_add_overflow(a->num, b->num, &result) )
+		return num_atom_alloc(result);
+	if (a->type == T_FLOAT || b->type == T_FLOAT)
+		return float_atom_alloc(num_to_double(a) + num_to_double(b));
+	return num_atom_from_bignum(bignum_add(to_bignum(a), to_bignum(b)));
+}
+
+atom_t* num_sub(atom_t *a, atom_t *b){
+	int64_t result;
+	if ( a->type == T_NUM && b->type == T_NUM && !__builtin_sub_overflow(a->num, b->num, &result) )
+		return num_atom_alloc(result);
+	if (a->type == T_FLOAT || b->type == T_FLOAT)
+		return float_atom_alloc(num_to_double(a) - num_to_double(b));
+	return num_atom_from_bignum(bignum_sub(to_bignum(a), to_bignum(b)));
+}
+
+atom_t* num_mul(atom_t *a, atom_t *b){
+	int64_t result;
+	if ( a->type == T_NUM && b->type == T_NUM && !__builtin_mul_overflow(a->num, b->num, &result) )
+		return num_atom_alloc(result);
+	if (a->type == T_FLOAT || b->type == T_FLOAT)
+		return float_atom_alloc(num_to_double(a) * num_to_double(b));
+	return num_atom_from_bignum(bignum_mul(to_bignum(a), to_bignum(b)));
+}
+
+// INT64_MIN / -1 is the only int64_t division that overflows
+atom_t* num_div(atom_t *a, atom_t *b){
+	if ( a->type == T_NUM && b->type == T_NUM && !(a->num == INT64_MIN && b->num == -1) )
+		return num_atom_alloc(a->num / b->num);
+	if (a->type == T_FLOAT || b->type == T_FLOAT)
+		return float_atom_alloc(num_to_double(a) / num_to_double(b));
+	return num_atom_from_bignum(bignum_div(to_bignum(a), to_bignum(b), NULL));
+}
+
+atom_t* num_mod(atom_t *a, atom_t *b){
+	if ( a->type == T_NUM && b->type == T_NUM && !(a->num == INT64_MIN && b->num == -1) )
+		return num_atom_alloc(a->num % b->num);
+	if (a->type == T_FLOAT || b->type == T_FLOAT)
+		return float_atom_alloc(fmod(num_to_double(a), num_to_double(b)));
+	
+	bignum_t *remainder = NULL;
+	bignum_div(to_bignum(a), to_bignum(b), &remainder);
+	return num_atom_from_bignum(remainder);
+}
+
+/**
+ * Returns -1, 0 or 1 if `a` is less than, equal to or greater than `b`. Returns NUM_UNORDERED
+ * if one of them is NaN.
+ */
+int num_cmp(atom_t *a, atom_t *b){
+	if (a->type == T_NUM && b->type == T_NUM)
+		return (a->num < b->num) ? -1 : (a->num > b->num);
+	if (a->type == T_FLOAT || b->type == T_FLOAT) {
+		double x = num_to_double(a), y = num_to_double(b);
+		if (isnan(x) || isnan(y))
+			return NUM_UNORDERED;
+		return (x < y) ? -1 : (x > y);
+	}
+	return bignum_cmp(to_bignum(a), to_bignum(b));
+}
\ No newline at end of file
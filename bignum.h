@@ -0,0 +1,56 @@
+#ifndef _BIGNUM_H
+#define _BIGNUM_H
+
+/**
+ * Arbitrary-precision integers and arithmetic on number atoms (T_NUM, T_BIGNUM and T_FLOAT).
+ * Integers are T_NUM atoms as long as they fit into an int64_t. The num_* functions check for
+ * overflows and only switch to bignums (T_BIGNUM atoms) if the result doesn't fit. Results that
+ * fit into an int64_t again are always turned back into T_NUM atoms. Therefore a T_BIGNUM atom
+ * is never equal to a T_NUM atom. If one operand is a T_FLOAT the operation is done with doubles
+ * and the result is a T_FLOAT, too.
+ *
+ * Bignums are immutable once created. The magnitude is stored as base 2^32 digits, the least
+ * significant digit first.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "memory.h"
+
+struct bignum {
+	bool negative;
+	// Number of digits, the most significant digit is never 0. Zero has no digits at all.
+	size_t length;
+	uint32_t digits[];
+};
+
+bignum_t* bignum_from_int(int64_t value);
+bool bignum_to_int(bignum_t *value, int64_t *result);
+double bignum_to_double(bignum_t *value);
+bignum_t* bignum_from_str(const char *str);
+char* bignum_to_str(bignum_t *value);
+
+int bignum_cmp(bignum_t *a, bignum_t *b);
+bignum_t* bignum_add(bignum_t *a, bignum_t *b);
+bignum_t* bignum_sub(bignum_t *a, bignum_t *b);
+bignum_t* bignum_mul(bignum_t *a, bignum_t *b);
+bignum_t* bignum_div(bignum_t *a, bignum_t *b, bignum_t **remainder);
+
+// Arithmetic on number atoms. An integer divisor of num_div() and num_mod() must not be 0.
+static inline bool is_num_atom(atom_t *atom){
+	return atom->type == T_NUM || atom->type == T_BIGNUM || atom->type == T_FLOAT;
+}
+
+// Returned by num_cmp() if one of the operands is NaN
+#define NUM_UNORDERED 2
+
+atom_t* num_atom_from_bignum(bignum_t *value);
+double num_to_double(atom_t *atom);
+atom_t* num_add(atom_t *a, atom_t *b);
+atom_t* num_sub(atom_t *a, atom_t *b);
+atom_t* num_mul(atom_t *a, atom_t *b);
+atom_t* num_div(atom_t *a, atom_t *b);
+atom_t* num_mod(atom_t *a, atom_t *b);
+int num_cmp(atom_t *a, atom_t *b);
+
+#endif
\ No newline at end of file
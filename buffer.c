@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "buffer.h"
+#include "array.h"
+
+// Size of the reads for files that can't be mapped (e.g. pipes)
+#define BUFFER_READ_CHUNK (64 * 1024)
+
+
+//
+// Files
+//
+
+static void unmap_buffer(void *obj, void *data){
+	atom_t *buffer = obj;
+	munmap(buffer->array.data, (size_t)data);
+}
+
+/**
+ * Reads files that can't be mapped until their end.
+ */
+static atom_t* read_stream(int fd){
+	size_t length = 0, capacity = BUFFER_READ_CHUNK;
+	uint8_t *data = gc_alloc_atomic(capacity);
+	
+	while (true) {
+		if (length == capacity) {
+			uint8_t *new_data = gc_alloc_atomic(capacity * 2);
+			memcpy(new_data, data, length);
+			gc_free(data);
+			data = new_data;
+			capacity *= 2;
+		}
+		
+		ssize_t bytes_read = read(fd, data + length, capacity - length);
+		if (bytes_read == 0)
+			break;
+		if (bytes_read < 0 && errno == EINTR)
+			continue;
+		if (bytes_read < 0)
+			return NULL;
+		length += bytes_read;
+	}
+	
+	return array_atom_alloc(ARRAY_U8, data, length);
+}
+
+/**
+ * Returns the content of the file as an u8 array or NULL if it can't be read (errno is set).
+ */
+atom_t* buffer_read_file(const char *path){
+	int fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+	
+	struct stat info;
+	if (fstat(fd, &info) == -1) {
+		close(fd);
+		return NULL;
+	}
+	
+	atom_t *buffer = NULL;
+	if ( S_ISREG(info.st_mode) && info.st_size > 0 ) {
+		void *data = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED) {
+			madvise(data, info.st_size, MADV_SEQUENTIAL);
+			buffer = array_atom_alloc(ARRAY_U8, data, info.st_size);
+			gc_register_finalizer(buffer, unmap_buffer, (void*)(size_t)info.st_size);
+		}
+	}
+	
+	if (buffer == NULL)
+		buffer = read_stream(fd);
+	
+	int saved_errno = errno;
+	close(fd);
+	errno = saved_errno;
+	return buffer;
+}
+
+/**
+ * Writes `length` bytes to the file, with as few write() calls as possible. Returns false if that
+ * fails (errno is set).
+ */
+bool buffer_write_file(const char *path, const void *data, size_t length, bool append){
+	int fd = open(path, O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0666);
+	if (fd == -1)
+		return false;
+	
+	const uint8_t *pos = data;
+	while (length > 0) {
+		ssize_t bytes_written = write(fd, pos, length);
+		if (bytes_written < 0 && errno == EINTR)
+			continue;
+		if (bytes_written < 0) {
+			int saved_errno = errno;
+			close(fd);
+			errno = saved_errno;
+			return false;
+		}
+		pos += bytes_written;
+		length -= bytes_written;
+	}
+	
+	return close(fd) == 0;
+}
+
+
+//
+// Integers at byte offsets
+//
+
+/**
+ * Parses names like u8, i16le or u32be. Integers wider than one byte need an le or be suffix.
+ * Only i64 is supported for 64 bits since u64 values don't fit into a number atom.
+ */
+bool buffer_parse_int_type(const char *name, buffer_int_t *type){
+	if (name[0] != 'u' && name[0] != 'i')
+		return false;
+	type->is_signed = (name[0] == 'i');
+	
+	char *suffix;
+	long bits = strtol(name + 1, &suffix, 10);
+	if (bits != 8 && bits != 16 && bits != 32 && bits != 64)
+		return false;
+	if (bits == 64 && !type->is_signed)
+		return false;
+	type->size = bits / 8;
+	
+	if (bits == 8 && suffix[0] == '\0')
+		type->big_endian = false;
+	else if (bits > 8 && strcmp(suffix, "le") == 0)
+		type->big_endian = false;
+	else if (bits > 8 && strcmp(suffix, "be") == 0)
+		type->big_endian = true;
+	else
+		return false;
+	
+	return true;
+}
+
+/**
+ * Reads the integer at `offset`. It has to be within the buffer.
+ */
+int64_t buffer_get_int(atom_t *buffer, size_t offset, buffer_int_t type){
+	assert(buffer->array.kind == ARRAY_U8 && offset + type.size <= buffer->array.length);
+	const uint8_t *bytes = (uint8_t*)buffer->array.data + offset;
+	
+	uint64_t value = 0;
+	for(size_t i = 0; i < type.size; i++){
+		size_t shift = type.big_endian ? (type.size - 1 - i) * 8 : i * 8;
+		value |= (uint64_t)bytes[i] << shift;
+	}
+	
+	// Extend the sign bit of smaller integers
+	if (type.is_signed && type.size < 8) {
+		uint64_t sign_bit = 1ULL << (type.size * 8 - 1);
+		value = (value ^ sign_bit) - sign_bit;
+	}
+	
+	return value;
+}
+
+/**
+ * Stores the lower bytes of `value` at `offset`. It has to be within the buffer.
+ */
+void buffer_set_int(atom_t *buffer, size_t offset, buffer_int_t type, int64_t value){
+	assert(buffer->array.kind == ARRAY_U8 && offset + type.size <= buffer->array.length);
+	uint8_t *bytes = (uint8_t*)buffer->array.data + offset;
+	
+	for(size_t i = 0; i < type.size; i++){
+		size_t shift = type.big_endian ? (type.size - 1 - i) * 8 : i * 8;
+		bytes[i] = (uint64_t)value >> shift;
+	}
+}
\ No newline at end of file
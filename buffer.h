@@ -0,0 +1,29 @@
+#ifndef _BUFFER_H
+#define _BUFFER_H
+
+/**
+ * Byte buffers are u8 arrays (see array.h), so all array buildins work on them. This module reads
+ * and writes them from and to files and accesses integers stored at byte offsets.
+ *
+ * Regular files are mapped into memory instead of being read. The mapping is private: writing
+ * to the buffer doesn't change the file. It's unmapped when the buffer is collected.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "memory.h"
+
+// Layout of an integer within a buffer
+typedef struct {
+	uint8_t size;
+	bool is_signed, big_endian;
+} buffer_int_t;
+
+atom_t* buffer_read_file(const char *path);
+bool buffer_write_file(const char *path, const void *data, size_t length, bool append);
+
+bool buffer_parse_int_type(const char *name, buffer_int_t *type);
+int64_t buffer_get_int(atom_t *buffer, size_t offset, buffer_int_t type);
+void buffer_set_int(atom_t *buffer, size_t offset, buffer_int_t type, int64_t value);
+
+#endif
\ No newline at end of file
@@ -3,11 +3,20 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <errno.h>
 
 #include "buildins.h"
 #include "eval.h"
 #include "bytecode_compiler.h"
 #include "bytecode_generator.h"
+#include "bignum.h"
+#include "hash.h"
+#include "array.h"
+#include "str.h"
+#include "buffer.h"
+#include "sort.h"
+#include "pool.h"
+#include "printer.h"
 #include "logger.h"
 
 //
@@ -27,20 +36,18 @@ atom_t* buildin_define(atom_t *args, env_t *env){
 void compile_define(atom_t *cl, atom_t *args, env_t *env){
 	if (args->first->type != T_SYM || args->rest->type != T_PAIR || args->rest->rest->type != T_NIL){
 		warn("define requires two arguments and the first one has to be a symbol");
-		bcg_gen_op(&cl->bytecode, BC_LOAD_NIL);
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
 		return;
 	}
 	
-	// Add the name to the variable name list
+	// Add the name to the variable name list. The name is visible in the value expr so lambdas can
+	// call themselves recursively.
 	atom_t *name_atom = args->first;
-	cl->comp_data->var_count++;
-	size_t names_length = cl->comp_data->arg_count + cl->comp_data->var_count;
-	cl->comp_data->names = gc_realloc(cl->comp_data->names, names_length * sizeof(cl->comp_data->names[0]));
-	cl->comp_data->names[names_length-1] = name_atom->sym;
+	size_t idx = bcc_alloc_local(cl, name_atom->sym);
 	
 	// Compile value expr and store the initial value afterwards
 	bcc_compile_expr(cl, args->rest->first, env);
-	bcg_gen(&cl->bytecode, (instruction_t){BC_STORE_LOCAL, .index = cl->comp_data->var_count - 1, .offset = 0});
+	bcg_gen(&cl->comp_data->bytecode, (instruction_t){BC_STORE_LOCAL, .index = idx, .offset = 0});
 }
 
 
@@ -57,7 +64,7 @@ atom_t* set_eval(atom_t *args, env_t *env){
 void set_compile(atom_t *cl, atom_t *args, env_t *env){
 	if (args->first->type != T_SYM || args->rest->type != T_PAIR || args->rest->rest->type != T_NIL){
 		warn("set requires two arguments and the first one has to be a symbol");
-		bcg_gen_op(&cl->bytecode, BC_LOAD_NIL);
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
 		return;
 	}
 	
@@ -69,29 +76,26 @@ void set_compile(atom_t *cl, atom_t *args, env_t *env){
 	
 	// Search for the name in the variable lists
 	ssize_t idx;
-	size_t scope_offset = 0;
-	atom_t *current_cl = cl;
-	do {
-		if ( (idx = bcc_symbol_in_names(current_cl, name_atom)) != -1 ) {
-			// symbol is known in current scope (lambda)
-			if (idx < current_cl->comp_data->arg_count) {
-				// symbol identifies an argument, can't set args!
-				warn("set: can not change the value of arguments!");
-			} else {
-				// symbol identifies a local variable, generate a save-var instruction
-				idx = idx - current_cl->comp_data->arg_count;
-				bcg_gen(&cl->bytecode, (instruction_t){BC_STORE_LOCAL, .index = idx, .offset = scope_offset});
-			}
-			break;
+	if ( (idx = bcc_symbol_in_names(cl, name_atom)) != -1 ) {
+		// symbol is known in current scope (lambda)
+		if (idx < cl->comp_data->arg_count) {
+			// symbol identifies an argument, can't set args!
+			warn("set: can not change the value of arguments!");
+		} else {
+			// symbol identifies a local variable, generate a save-var instruction
+			idx = idx - cl->comp_data->arg_count;
+			bcg_gen(&cl->comp_data->bytecode, (instruction_t){BC_STORE_LOCAL, .index = idx, .offset = 0});
 		}
-		scope_offset++;
-		current_cl = current_cl->comp_data->parent;
-	} while(current_cl);
-	
-	if (current_cl == NULL){
+	} else if ( (idx = bcc_capture(cl, name_atom)) != -1 ) {
+		// symbol is a variable of an outer lambda, only captured locals are boxed and can be changed
+		if (cl->comp_data->captures[idx].boxed)
+			bcg_gen(&cl->comp_data->bytecode, (instruction_t){BC_STORE_BOXED_CAPTURED, .index = idx});
+		else
+			warn("set: can not change the value of arguments!");
+	} else {
 		// Symbol not found in any argument or variable lists of all parents
 		warn("set: can't find variable %s!", name_atom->sym);
-		bcg_gen_op(&cl->bytecode, BC_LOAD_NIL);
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
 	}
 }
 
@@ -110,40 +114,53 @@ atom_t* buildin_if(atom_t *args, env_t *env){
 void compile_if(atom_t *cl, atom_t *args, env_t *env){
 	if (args->rest->type != T_PAIR || args->rest->rest->type != T_PAIR || args->rest->rest->rest->type != T_NIL){
 		warn("if requires exactly three arguments");
-		bcg_gen_op(&cl->bytecode, BC_LOAD_NIL);
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
+		return;
+	}
+	
+	// Only compile the branch that is taken if the condition is a constant
+	atom_t *constant_cond = bcc_fold_constant(cl, args->first, env);
+	if (constant_cond != NULL) {
+		if (constant_cond->type != T_FALSE)
+			bcc_compile_expr(cl, args->rest->first, env);
+		else
+			bcc_compile_expr(cl, args->rest->rest->first, env);
 		return;
 	}
 	
 	// compile condition
 	bcc_compile_expr(cl, args->first, env);
-	size_t false_offset = bcg_gen(&cl->bytecode, (instruction_t){BC_JUMP_IF_FALSE, .jump_offset = 0});
+	size_t false_offset = bcg_gen(&cl->comp_data->bytecode, (instruction_t){BC_JUMP_IF_FALSE, .jump_offset = 0});
 	
 	// compile true case
 	bcc_compile_expr(cl, args->rest->first, env);
-	size_t end_offset = bcg_gen(&cl->bytecode, (instruction_t){BC_JUMP, .jump_offset = 0});
-	bcg_backpatch_target_in(&cl->bytecode, false_offset);
+	size_t end_offset = bcg_gen(&cl->comp_data->bytecode, (instruction_t){BC_JUMP, .jump_offset = 0});
+	bcg_backpatch_target_in(&cl->comp_data->bytecode, false_offset);
 	
 	// compile false case
 	bcc_compile_expr(cl, args->rest->rest->first, env);
-	bcg_backpatch_target_in(&cl->bytecode, end_offset);
+	bcg_backpatch_target_in(&cl->comp_data->bytecode, end_offset);
 }
 
 
 atom_t* buildin_quote(atom_t *args, env_t *env){
 	if (args->rest->type != T_NIL)
 		return warn("quote takes exactly one argument"), nil_atom();
+	// Values passed by eval_apply() or compiled code
+	if (args->first->type == T_VALUE)
+		return args->first->boxed;
 	return args->first;
 }
 
 void compile_quote(atom_t *cl, atom_t *args, env_t *env){
 	if (args->rest->type != T_NIL){
 		warn("quote takes exactly one argument");
-		bcg_gen_op(&cl->bytecode, BC_LOAD_NIL);
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
 		return;
 	}
 	
 	size_t idx = bcc_add_atom_to_literal_table(cl, args->first);
-	bcg_gen(&cl->bytecode, (instruction_t){BC_LOAD_LITERAL, .index = idx, .offset = 0});
+	bcg_gen(&cl->comp_data->bytecode, (instruction_t){BC_LOAD_LITERAL, .index = idx, .offset = 0});
 }
 
 
@@ -157,7 +174,7 @@ atom_t* buildin_begin(atom_t *args, env_t *env){
 void compile_begin(atom_t *cl, atom_t *args, env_t *env){
 	if (args->type != T_PAIR){
 		warn("begin needs at least one expr to compile");
-		bcg_gen_op(&cl->bytecode, BC_LOAD_NIL);
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
 		return;
 	}
 	
@@ -166,12 +183,153 @@ void compile_begin(atom_t *cl, atom_t *args, env_t *env){
 	
 	// If there are other ones drop the prev stack value and compile the next expr
 	for(atom_t *pair = args->rest; pair->type == T_PAIR; pair = pair->rest){
-		bcg_gen_op(&cl->bytecode, BC_DROP);
+		bcg_gen_op(&cl->comp_data->bytecode, BC_DROP);
 		bcc_compile_expr(cl, pair->first, env);
 	}
 }
 
 
+atom_t* buildin_while(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR)
+		return warn("while requires a condition and at least one body expression"), nil_atom();
+	
+	while( eval_atom(args->first, env)->type == T_TRUE ){
+		for(atom_t *pair = args->rest; pair->type == T_PAIR; pair = pair->rest)
+			eval_atom(pair->first, env);
+	}
+	
+	return nil_atom();
+}
+
+/**
+ * Compiles the loop into a backward jump to the condition. The loop always results in nil, the
+ * value of the body is dropped after each iteration so the loop runs with a constant stack size.
+ */
+void compile_while(atom_t *cl, atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR){
+		warn("while requires a condition and at least one body expression");
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
+		return;
+	}
+	
+	// compile condition
+	size_t loop_start = cl->comp_data->bytecode.length;
+	bcc_compile_expr(cl, args->first, env);
+	size_t end_offset = bcg_gen(&cl->comp_data->bytecode, (instruction_t){BC_JUMP_IF_FALSE, .jump_offset = 0});
+	
+	// compile body and jump back to the condition
+	compile_begin(cl, args->rest, env);
+	bcg_gen_op(&cl->comp_data->bytecode, BC_DROP);
+	bcg_gen_jump_to(&cl->comp_data->bytecode, BC_JUMP, loop_start);
+	bcg_backpatch_target_in(&cl->comp_data->bytecode, end_offset);
+	
+	bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
+}
+
+
+static bool let_args_valid(atom_t *args){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR)
+		return false;
+	for(atom_t *pair = args->first; pair->type == T_PAIR; pair = pair->rest){
+		atom_t *binding = pair->first;
+		if (binding->type != T_PAIR || binding->first->type != T_SYM || binding->rest->type != T_PAIR || binding->rest->rest->type != T_NIL)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Evals let and let* in a new env. For let the values are evaled in the outer env, for let*
+ * each value can use the bindings before it.
+ */
+static atom_t* eval_let(atom_t *args, env_t *env, bool sequential){
+	if ( !let_args_valid(args) )
+		return warn("let requires a list of (name value) bindings and at least one body expression"), nil_atom();
+	
+	env_t *let_env = env_alloc(env);
+	for(atom_t *pair = args->first; pair->type == T_PAIR; pair = pair->rest){
+		atom_t *binding = pair->first;
+		env_def(let_env, binding->first->sym, eval_atom(binding->rest->first, sequential ? let_env : env));
+	}
+	
+	return buildin_begin(args->rest, let_env);
+}
+
+/**
+ * Compiles the bindings into local slots of the current frame. At the end of the block the names
+ * are hidden again and the slots can be reused by following let blocks. Slots that are captured
+ * by lambdas (boxed) or used by a define in the body are not reused. Lambdas created in the block
+ * might still use them.
+ */
+static void compile_let_block(atom_t *cl, atom_t *args, env_t *env, bool sequential){
+	if ( !let_args_valid(args) ){
+		warn("let requires a list of (name value) bindings and at least one body expression");
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
+		return;
+	}
+	
+	compiler_data_t cd = cl->comp_data;
+	size_t block_start = cd->local_count;
+	size_t binding_count = 0;
+	for(atom_t *pair = args->first; pair->type == T_PAIR; pair = pair->rest)
+		binding_count++;
+	size_t slots[binding_count];
+	
+	// For let the names stay invisible until all values are compiled
+	size_t i = 0;
+	for(atom_t *pair = args->first; pair->type == T_PAIR; pair = pair->rest, i++){
+		atom_t *binding = pair->first;
+		bcc_compile_expr(cl, binding->rest->first, env);
+		slots[i] = bcc_alloc_local(cl, sequential ? binding->first->sym : NULL);
+		
+		size_t store_index = bcg_gen(&cd->bytecode, (instruction_t){BC_STORE_LOCAL, .index = slots[i], .offset = 0});
+		bcg_gen_op(&cd->bytecode, BC_DROP);
+		cd->let_store_count++;
+		cd->let_stores = gc_realloc(cd->let_stores, cd->let_store_count * sizeof(cd->let_stores[0]));
+		cd->let_stores[cd->let_store_count-1] = store_index;
+	}
+	
+	if (!sequential) {
+		i = 0;
+		for(atom_t *pair = args->first; pair->type == T_PAIR; pair = pair->rest, i++)
+			cd->names[cd->arg_count + slots[i]] = pair->first->first->sym;
+	}
+	
+	compile_begin(cl, args->rest, env);
+	
+	// End of the block: hide all names defined in it and release the slots down to the last one
+	// that has to be kept
+	size_t block_end = block_start;
+	for(size_t slot = block_start; slot < cd->local_count; slot++){
+		bool own_slot = false;
+		for(i = 0; i < binding_count; i++){
+			if (slots[i] == slot)
+				own_slot = true;
+		}
+		if ( !own_slot || bcc_local_is_boxed(cl, slot) )
+			block_end = slot + 1;
+		cd->names[cd->arg_count + slot] = NULL;
+	}
+	cd->local_count = block_end;
+}
+
+atom_t* buildin_let(atom_t *args, env_t *env){
+	return eval_let(args, env, false);
+}
+
+void compile_let(atom_t *cl, atom_t *args, env_t *env){
+	compile_let_block(cl, args, env, false);
+}
+
+atom_t* buildin_let_star(atom_t *args, env_t *env){
+	return eval_let(args, env, true);
+}
+
+void compile_let_star(atom_t *cl, atom_t *args, env_t *env){
+	compile_let_block(cl, args, env, true);
+}
+
+
 atom_t* buildin_lambda(atom_t *args, env_t *env){
 	if (args->rest->type != T_PAIR)
 		return warn("lambda needs at least two arguments (arg list and body)"), nil_atom();
@@ -205,7 +363,7 @@ atom_t* buildin_lambda(atom_t *args, env_t *env){
 void compile_lambda(atom_t *cl, atom_t *args, env_t *env){
 	if (args->type != T_PAIR){
 		warn("lambda needs at least two arguments (arg list and body)");
-		bcg_gen_op(&cl->bytecode, BC_LOAD_NIL);
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
 		return;
 	}
 	
@@ -224,7 +382,60 @@ void compile_lambda(atom_t *cl, atom_t *args, env_t *env){
 	
 	atom_t *child_cl = bcc_compile_to_lambda(arg_names, body, env, cl);
 	size_t literal_idx = bcc_add_atom_to_literal_table(cl, child_cl);
-	bcg_gen(&cl->bytecode, (instruction_t){BC_LOAD_LAMBDA, .index = literal_idx, .offset = 0});
+	bcg_gen(&cl->comp_data->bytecode, (instruction_t){BC_LOAD_LAMBDA, .index = literal_idx, .offset = 0});
+}
+
+
+/**
+ * (apply function arg ... list), calls the function with the args followed by the elements of
+ * the list.
+ */
+atom_t* buildin_apply(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR)
+		return warn("apply requires a function and a list"), nil_atom();
+	
+	atom_t *function = eval_atom(args->first, env);
+	size_t fixed_count = 0;
+	atom_t *last_arg = args->rest;
+	for(; last_arg->rest->type == T_PAIR; last_arg = last_arg->rest)
+		fixed_count++;
+	
+	// The args are evaled in order, the list last. The list can be long so the args are allocated
+	// on the heap instead of the C stack.
+	atom_t **call_args = gc_alloc((fixed_count > 0 ? fixed_count : 1) * sizeof(atom_t*));
+	size_t i = 0;
+	for(atom_t *arg = args->rest; arg != last_arg; arg = arg->rest)
+		call_args[i++] = eval_atom(arg->first, env);
+	
+	atom_t *list = eval_atom(last_arg->first, env);
+	if (list->type != T_PAIR && list->type != T_NIL)
+		return warn("apply: the last argument has to eval to a list"), nil_atom();
+	size_t arg_count = fixed_count;
+	for(atom_t *pair = list; pair->type == T_PAIR; pair = pair->rest)
+		arg_count++;
+	
+	if (arg_count > fixed_count)
+		call_args = gc_realloc(call_args, arg_count * sizeof(atom_t*));
+	for(atom_t *pair = list; pair->type == T_PAIR; pair = pair->rest)
+		call_args[i++] = pair->first;
+	
+	return eval_apply(function, call_args, arg_count, env);
+}
+
+void compile_apply(atom_t *cl, atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR){
+		warn("apply requires a function and a list");
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
+		return;
+	}
+	
+	bcc_compile_expr(cl, args->first, env);
+	size_t arg_count = 0;
+	for(atom_t *arg = args->rest; arg->type == T_PAIR; arg = arg->rest){
+		bcc_compile_expr(cl, arg->first, env);
+		arg_count++;
+	}
+	bcg_gen(&cl->comp_data->bytecode, (instruction_t){BC_APPLY, .num = arg_count});
 }
 
 
@@ -241,13 +452,13 @@ atom_t* buildin_cons(atom_t *args, env_t *env){
 void compile_cons(atom_t *cl, atom_t *args, env_t *env){
 	if (args->rest->type != T_PAIR || args->rest->rest->type != T_NIL){
 		warn("cons needs exactly two arguments to build a pair");
-		bcg_gen_op(&cl->bytecode, BC_LOAD_NIL);
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
 		return;
 	}
 	
 	bcc_compile_expr(cl, args->first, env);
 	bcc_compile_expr(cl, args->rest->first, env);
-	bcg_gen(&cl->bytecode, (instruction_t){BC_CONS});
+	bcg_gen(&cl->comp_data->bytecode, (instruction_t){BC_CONS});
 }
 
 
@@ -265,12 +476,12 @@ atom_t* buildin_first(atom_t *args, env_t *env){
 void compile_first(atom_t *cl, atom_t *args, env_t *env){
 	if (args->rest->type != T_NIL){
 		warn("first requires exactly one argument");
-		bcg_gen_op(&cl->bytecode, BC_LOAD_NIL);
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
 		return;
 	}
 	
 	bcc_compile_expr(cl, args->first, env);
-	bcg_gen(&cl->bytecode, (instruction_t){BC_FIRST});
+	bcg_gen(&cl->comp_data->bytecode, (instruction_t){BC_FIRST});
 }
 
 
@@ -288,138 +499,1133 @@ atom_t* buildin_rest(atom_t *args, env_t *env){
 void compile_rest(atom_t *cl, atom_t *args, env_t *env){
 	if (args->rest->type != T_NIL){
 		warn("rest requires exactly one argument");
-		bcg_gen_op(&cl->bytecode, BC_LOAD_NIL);
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
 		return;
 	}
 	
 	bcc_compile_expr(cl, args->first, env);
-	bcg_gen(&cl->bytecode, (instruction_t){BC_REST});
+	bcg_gen(&cl->comp_data->bytecode, (instruction_t){BC_REST});
 }
 
 
+//
+// Lists
+//
+
+/**
+ * Iterates over the elements of a list or a vector. Lists end at the first atom that isn't a
+ * pair.
+ */
+typedef struct {
+	atom_t *vector, *pair;
+	size_t index;
+} seq_iter_t;
+
+static bool seq_iter_init(seq_iter_t *it, atom_t *seq){
+	it->vector = (seq->type == T_VECTOR) ? seq : NULL;
+	it->pair = seq;
+	it->index = 0;
+	return seq->type == T_VECTOR || seq->type == T_PAIR || seq->type == T_NIL;
+}
+
+// Returns NULL at the end
+static atom_t* seq_iter_next(seq_iter_t *it){
+	if (it->vector != NULL)
+		return (it->index < it->vector->length) ? it->vector->elements[it->index++] : NULL;
+	if (it->pair->type != T_PAIR)
+		return NULL;
+	atom_t *element = it->pair->first;
+	it->pair = it->pair->rest;
+	return element;
+}
+
+/**
+ * Evals the function and sequence arguments of map, filter and for-each. Returns false (after a
+ * warning) if the sequence isn't a list or vector.
+ */
+static bool eval_function_and_seq(atom_t *args, env_t *env, char *name, atom_t **function, atom_t **seq, seq_iter_t *it){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || args->rest->rest->type != T_NIL)
+		return warn("%s requires a function and a list or vector", name), false;
+	
+	*function = eval_atom(args->first, env);
+	*seq = eval_atom(args->rest->first, env);
+	if ( !seq_iter_init(it, *seq) )
+		return warn("%s: the second argument has to eval to a list or vector", name), false;
+	return true;
+}
+
+/**
+ * (map function seq), returns a list for lists and a vector for vectors.
+ */
+atom_t* buildin_map(atom_t *args, env_t *env){
+	atom_t *function, *seq;
+	seq_iter_t it;
+	if ( !eval_function_and_seq(args, env, "map", &function, &seq, &it) )
+		return nil_atom();
+	
+	if (seq->type == T_VECTOR) {
+		atom_t *result = vector_atom_alloc(seq->length, nil_atom());
+		for(size_t i = 0; i < seq->length; i++)
+			result->elements[i] = eval_apply(function, &seq->elements[i], 1, env);
+		return result;
+	}
+	
+	atom_t *result = nil_atom(), **next = &result;
+	for(atom_t *element = seq_iter_next(&it); element != NULL; element = seq_iter_next(&it)){
+		*next = pair_atom_alloc(eval_apply(function, &element, 1, env), nil_atom());
+		next = &(*next)->rest;
+	}
+	return result;
+}
+
+/**
+ * (filter predicate seq), keeps the elements for which the predicate doesn't return false. Like
+ * map it returns a list for lists and a vector for vectors.
+ */
+atom_t* buildin_filter(atom_t *args, env_t *env){
+	atom_t *function, *seq;
+	seq_iter_t it;
+	if ( !eval_function_and_seq(args, env, "filter", &function, &seq, &it) )
+		return nil_atom();
+	
+	atom_t *result = nil_atom(), **next = &result;
+	size_t count = 0;
+	for(atom_t *element = seq_iter_next(&it); element != NULL; element = seq_iter_next(&it)){
+		if (eval_apply(function, &element, 1, env)->type == T_FALSE)
+			continue;
+		*next = pair_atom_alloc(element, nil_atom());
+		next = &(*next)->rest;
+		count++;
+	}
+	
+	if (seq->type == T_VECTOR) {
+		atom_t *vector = vector_atom_alloc(count, nil_atom());
+		for(size_t i = 0; i < count; i++, result = result->rest)
+			vector->elements[i] = result->first;
+		return vector;
+	}
+	return result;
+}
+
+/**
+ * (reduce function initial seq), calls the function with the result so far and each element:
+ * (function (function initial e1) e2) and so on. Returns initial for empty sequences.
+ */
+atom_t* buildin_reduce(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || args->rest->rest->type != T_PAIR || args->rest->rest->rest->type != T_NIL)
+		return warn("reduce requires a function, an initial value and a list or vector"), nil_atom();
+	
+	atom_t *function = eval_atom(args->first, env);
+	atom_t *call_args[2] = { eval_atom(args->rest->first, env), NULL };
+	seq_iter_t it;
+	if ( !seq_iter_init(&it, eval_atom(args->rest->rest->first, env)) )
+		return warn("reduce: the third argument has to eval to a list or vector"), nil_atom();
+	
+	while ( (call_args[1] = seq_iter_next(&it)) != NULL )
+		call_args[0] = eval_apply(function, call_args, 2, env);
+	return call_args[0];
+}
+
+atom_t* buildin_for_each(atom_t *args, env_t *env){
+	atom_t *function, *seq;
+	seq_iter_t it;
+	if ( !eval_function_and_seq(args, env, "for-each", &function, &seq, &it) )
+		return nil_atom();
+	
+	for(atom_t *element = seq_iter_next(&it); element != NULL; element = seq_iter_next(&it))
+		eval_apply(function, &element, 1, env);
+	return nil_atom();
+}
+
+atom_t* buildin_length(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_NIL)
+		return warn("length requires exactly one argument"), nil_atom();
+	
+	atom_t *seq = eval_atom(args->first, env);
+	if (seq->type == T_VECTOR)
+		return num_atom_alloc(seq->length);
+	if (seq->type != T_PAIR && seq->type != T_NIL)
+		return warn("length: the argument has to eval to a list or vector"), nil_atom();
+	
+	size_t length = 0;
+	for(atom_t *pair = seq; pair->type == T_PAIR; pair = pair->rest)
+		length++;
+	return num_atom_alloc(length);
+}
+
+atom_t* buildin_reverse(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_NIL)
+		return warn("reverse requires exactly one argument"), nil_atom();
+	
+	atom_t *list = eval_atom(args->first, env);
+	if (list->type != T_PAIR && list->type != T_NIL)
+		return warn("reverse: the argument has to eval to a list"), nil_atom();
+	
+	atom_t *result = nil_atom();
+	for(atom_t *pair = list; pair->type == T_PAIR; pair = pair->rest)
+		result = pair_atom_alloc(pair->first, result);
+	return result;
+}
+
+/**
+ * (append list ...), copies all lists except the last one. The result shares the last list.
+ */
+atom_t* buildin_append(atom_t *args, env_t *env){
+	atom_t *result = nil_atom(), **next = &result;
+	
+	for(atom_t *arg = args; arg->type == T_PAIR; arg = arg->rest){
+		atom_t *list = eval_atom(arg->first, env);
+		if (list->type != T_PAIR && list->type != T_NIL)
+			return warn("append: all arguments have to eval to lists"), nil_atom();
+		
+		if (arg->rest->type != T_PAIR) {
+			*next = list;
+			break;
+		}
+		
+		for(atom_t *pair = list; pair->type == T_PAIR; pair = pair->rest){
+			*next = pair_atom_alloc(pair->first, nil_atom());
+			next = &(*next)->rest;
+		}
+	}
+	
+	return result;
+}
+
+static bool int_less(atom_t *a, atom_t *b, void *data){
+	return a->num < b->num;
+}
+
+static bool num_less(atom_t *a, atom_t *b, void *data){
+	return num_cmp(a, b) == -1;
+}
+
+static bool str_less(atom_t *a, atom_t *b, void *data){
+	size_t length = (a->str_length < b->str_length) ? a->str_length : b->str_length;
+	int result = memcmp(a->str, b->str, length);
+	return result < 0 || (result == 0 && a->str_length < b->str_length);
+}
+
+typedef struct {
+	atom_t *function;
+	env_t *env;
+} sort_call_t;
+
+static bool call_less(atom_t *a, atom_t *b, void *data){
+	sort_call_t *call = data;
+	atom_t *args[2] = { a, b };
+	return eval_apply(call->function, args, 2, call->env)->type != T_FALSE;
+}
+
+/**
+ * (sort seq [less]), returns a sorted copy of a list or vector. Without a less function numbers
+ * and strings are compared directly without calling any functions. The sort is stable.
+ */
+atom_t* buildin_sort(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || (args->rest->type != T_NIL && args->rest->rest->type != T_NIL))
+		return warn("sort requires a list or vector and an optional less function"), nil_atom();
+	
+	atom_t *seq = eval_atom(args->first, env);
+	seq_iter_t it;
+	if ( !seq_iter_init(&it, seq) )
+		return warn("sort: the first argument has to eval to a list or vector"), nil_atom();
+	
+	// Copy the elements into an array and see if they're all integers, numbers or strings
+	size_t length = 0;
+	for(atom_t *pair = seq; pair->type == T_PAIR; pair = pair->rest)
+		length++;
+	if (seq->type == T_VECTOR)
+		length = seq->length;
+	
+	atom_t **atoms = gc_alloc(length * sizeof(atom_t*));
+	bool all_ints = true, all_nums = true, all_strs = true;
+	for(size_t i = 0; i < length; i++){
+		atoms[i] = seq_iter_next(&it);
+		all_ints = all_ints && atoms[i]->type == T_NUM;
+		all_nums = all_nums && is_num_atom(atoms[i]);
+		all_strs = all_strs && atoms[i]->type == T_STR;
+	}
+	
+	if (args->rest->type == T_PAIR) {
+		sort_call_t call = { eval_atom(args->rest->first, env), env };
+		sort_atoms(atoms, length, call_less, &call);
+	} else if (all_ints) {
+		sort_atoms(atoms, length, int_less, NULL);
+	} else if (all_nums) {
+		sort_atoms(atoms, length, num_less, NULL);
+	} else if (all_strs) {
+		sort_atoms(atoms, length, str_less, NULL);
+	} else {
+		return warn("sort: without a less function all elements have to be numbers or strings"), nil_atom();
+	}
+	
+	if (seq->type == T_VECTOR) {
+		atom_t *vector = vector_atom_alloc(length, nil_atom());
+		memcpy(vector->elements, atoms, length * sizeof(atom_t*));
+		return vector;
+	}
+	
+	atom_t *result = nil_atom();
+	for(size_t i = length; i > 0; i--)
+		result = pair_atom_alloc(atoms[i-1], result);
+	return result;
+}
+
 
 //
-// Math
+// Parallelism
 //
 
-atom_t* buildin_plus(atom_t *args, env_t *env){
-	atom_t *first_arg = eval_atom(args->first, env);
-	atom_t *second_arg = eval_atom(args->rest->first, env);
+/**
+ * The functions of futures and pmap run on worker threads. They get the same atoms the calling
+ * thread uses without copying them, so they must not change them or any global bindings.
+ */
+typedef struct {
+	atom_t *future, *function;
+	atom_t **args;
+	size_t arg_count;
+	env_t *env;
+} future_call_t;
+
+static void run_future(void *data){
+	future_call_t *call = data;
+	call->future->future.result = eval_apply(call->function, call->args, call->arg_count, call->env);
+}
+
+/**
+ * (future function arg ...), calls the function with the args on a worker thread. Returns a
+ * future right away, touch waits for the result.
+ */
+atom_t* buildin_future(atom_t *args, env_t *env){
+	if (args->type != T_PAIR)
+		return warn("future requires a function and its arguments"), nil_atom();
+	
+	future_call_t *call = gc_alloc(sizeof(future_call_t));
+	call->function = eval_atom(args->first, env);
+	call->env = env;
+	call->arg_count = 0;
+	for(atom_t *arg = args->rest; arg->type == T_PAIR; arg = arg->rest)
+		call->arg_count++;
+	call->args = gc_alloc(call->arg_count * sizeof(atom_t*));
+	size_t i = 0;
+	for(atom_t *arg = args->rest; arg->type == T_PAIR; arg = arg->rest)
+		call->args[i++] = eval_atom(arg->first, env);
+	
+	call->future = future_atom_alloc();
+	call->future->future.task = pool_submit(run_future, call);
+	return call->future;
+}
+
+/**
+ * (touch value), waits for a future and returns its result. Other values are returned as they
+ * are. The waiting thread runs other queued tasks in the meantime. Also available as await.
+ */
+atom_t* buildin_touch(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_NIL)
+		return warn("touch requires exactly one argument"), nil_atom();
+	
+	atom_t *value = eval_atom(args->first, env);
+	if (value->type != T_FUTURE)
+		return value;
 	
-	if (first_arg->type != T_NUM || second_arg->type != T_NUM){
-		warn("plus only works on numbers");
+	pool_wait(value->future.task);
+	return value->future.result;
+}
+
+typedef struct {
+	atom_t *function;
+	env_t *env;
+	atom_t **elements, **results;
+	size_t start, end;
+} pmap_chunk_t;
+
+static void run_pmap_chunk(void *data){
+	pmap_chunk_t *chunk = data;
+	for(size_t i = chunk->start; i < chunk->end; i++)
+		chunk->results[i] = eval_apply(chunk->function, &chunk->elements[i], 1, chunk->env);
+}
+
+/**
+ * (pmap function seq), like map but the elements are split into chunks that are mapped in
+ * parallel. A few chunks per worker let faster workers steal the work of slower ones. The
+ * calling thread maps the first chunk itself.
+ */
+atom_t* buildin_pmap(atom_t *args, env_t *env){
+	atom_t *function, *seq;
+	seq_iter_t it;
+	if ( !eval_function_and_seq(args, env, "pmap", &function, &seq, &it) )
 		return nil_atom();
+	
+	size_t length = 0;
+	for(atom_t *pair = seq; pair->type == T_PAIR; pair = pair->rest)
+		length++;
+	if (seq->type == T_VECTOR)
+		length = seq->length;
+	
+	atom_t **elements = gc_alloc(length * sizeof(atom_t*));
+	for(size_t i = 0; i < length; i++)
+		elements[i] = seq_iter_next(&it);
+	atom_t *result = (seq->type == T_VECTOR) ? vector_atom_alloc(length, nil_atom()) : NULL;
+	atom_t **results = (result != NULL) ? result->elements : gc_alloc(length * sizeof(atom_t*));
+	
+	size_t chunk_count = pool_worker_count() * 4;
+	if (chunk_count > length)
+		chunk_count = length;
+	pmap_chunk_t *chunks = gc_alloc(chunk_count * sizeof(pmap_chunk_t));
+	pool_task_t **tasks = gc_alloc(chunk_count * sizeof(pool_task_t*));
+	for(size_t i = 0; i < chunk_count; i++){
+		chunks[i] = (pmap_chunk_t){
+			.function = function, .env = env,
+			.elements = elements, .results = results,
+			.start = length * i / chunk_count, .end = length * (i + 1) / chunk_count
+		};
+		if (i > 0)
+			tasks[i] = pool_submit(run_pmap_chunk, &chunks[i]);
 	}
 	
-	return num_atom_alloc(first_arg->num + second_arg->num);
+	if (chunk_count > 0)
+		run_pmap_chunk(&chunks[0]);
+	for(size_t i = 1; i < chunk_count; i++)
+		pool_wait(tasks[i]);
+	
+	if (result != NULL)
+		return result;
+	
+	result = nil_atom();
+	for(size_t i = length; i > 0; i--)
+		result = pair_atom_alloc(results[i-1], result);
+	return result;
 }
 
-void compile_plus(atom_t *cl, atom_t *args, env_t *env){
-	if (args->rest->type != T_PAIR || args->rest->rest->type != T_NIL){
-		warn("plus requires two arguments");
-		bcg_gen_op(&cl->bytecode, BC_LOAD_NIL);
+
+//
+// Vectors
+//
+
+/**
+ * Returns true if `vector` is a vector and `index` a number within its range. Otherwise a
+ * warning is printed and false returned.
+ */
+static bool vector_index_valid(atom_t *vector, atom_t *index, char *name){
+	if (vector->type != T_VECTOR)
+		return warn("%s: the first argument has to eval to a vector", name), false;
+	if (index->type != T_NUM)
+		return warn("%s: the index has to eval to a number", name), false;
+	if (index->num < 0 || (size_t)index->num >= vector->length)
+		return warn("%s: index %ld out of range", name, index->num), false;
+	return true;
+}
+
+atom_t* buildin_make_vector(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || (args->rest->type != T_NIL && args->rest->rest->type != T_NIL))
+		return warn("make-vector requires a length and an optional fill value"), nil_atom();
+	
+	atom_t *length = eval_atom(args->first, env);
+	if (length->type != T_NUM || length->num < 0)
+		return warn("make-vector: the length has to eval to a positive number"), nil_atom();
+	
+	atom_t *fill = (args->rest->type == T_PAIR) ? eval_atom(args->rest->first, env) : nil_atom();
+	return vector_atom_alloc(length->num, fill);
+}
+
+atom_t* buildin_vector_length(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_NIL)
+		return warn("vector-length requires exactly one argument"), nil_atom();
+	
+	atom_t *vector = eval_atom(args->first, env);
+	if (vector->type != T_VECTOR)
+		return warn("vector-length: the argument has to eval to a vector"), nil_atom();
+	
+	return num_atom_alloc(vector->length);
+}
+
+atom_t* buildin_vector_ref(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || args->rest->rest->type != T_NIL)
+		return warn("vector-ref requires two arguments"), nil_atom();
+	
+	atom_t *vector = eval_atom(args->first, env);
+	atom_t *index = eval_atom(args->rest->first, env);
+	if ( !vector_index_valid(vector, index, "vector-ref") )
+		return nil_atom();
+	
+	return vector->elements[index->num];
+}
+
+void compile_vector_ref(atom_t *cl, atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || args->rest->rest->type != T_NIL){
+		warn("vector-ref requires two arguments");
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
 		return;
 	}
 	
 	bcc_compile_expr(cl, args->first, env);
 	bcc_compile_expr(cl, args->rest->first, env);
-	bcg_gen_op(&cl->bytecode, BC_ADD);
+	bcg_gen_op(&cl->comp_data->bytecode, BC_VREF);
 }
 
-atom_t* buildin_minus(atom_t *args, env_t *env){
-	atom_t *first_arg = eval_atom(args->first, env);
-	atom_t *second_arg = eval_atom(args->rest->first, env);
+atom_t* buildin_vector_set(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || args->rest->rest->type != T_PAIR || args->rest->rest->rest->type != T_NIL)
+		return warn("vector-set! requires three arguments"), nil_atom();
 	
-	if (first_arg->type != T_NUM || second_arg->type != T_NUM){
-		warn("minus only works on numbers");
+	atom_t *vector = eval_atom(args->first, env);
+	atom_t *index = eval_atom(args->rest->first, env);
+	atom_t *value = eval_atom(args->rest->rest->first, env);
+	if ( !vector_index_valid(vector, index, "vector-set!") )
 		return nil_atom();
-	}
 	
-	return num_atom_alloc(first_arg->num - second_arg->num);
+	vector->elements[index->num] = value;
+	return value;
 }
 
-void compile_minus(atom_t *cl, atom_t *args, env_t *env){
-	if (args->rest->type != T_PAIR || args->rest->rest->type != T_NIL){
-		warn("minus requires two arguments");
-		bcg_gen_op(&cl->bytecode, BC_LOAD_NIL);
+void compile_vector_set(atom_t *cl, atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || args->rest->rest->type != T_PAIR || args->rest->rest->rest->type != T_NIL){
+		warn("vector-set! requires three arguments");
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
 		return;
 	}
 	
 	bcc_compile_expr(cl, args->first, env);
 	bcc_compile_expr(cl, args->rest->first, env);
-	bcg_gen_op(&cl->bytecode, BC_SUB);
+	bcc_compile_expr(cl, args->rest->rest->first, env);
+	bcg_gen_op(&cl->comp_data->bytecode, BC_VSET);
 }
 
-atom_t* buildin_multiply(atom_t *args, env_t *env){
-	atom_t *first_arg = eval_atom(args->first, env);
-	atom_t *second_arg = eval_atom(args->rest->first, env);
+
+//
+// Hash tables
+//
+
+/**
+ * Evals the first argument and returns its hash table. Returns NULL (after a warning) if it
+ * isn't a hash table.
+ */
+static hash_t* eval_hash_arg(atom_t *args, env_t *env, char *name){
+	atom_t *hash = eval_atom(args->first, env);
+	if (hash->type != T_HASH)
+		return warn("%s: the first argument has to eval to a hash", name), NULL;
+	return hash->hash;
+}
+
+atom_t* buildin_make_hash(atom_t *args, env_t *env){
+	if (args->type != T_NIL)
+		return warn("make-hash doesn't take any arguments"), nil_atom();
+	return hash_atom_alloc(hash_new(0));
+}
+
+atom_t* buildin_hash_get(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || (args->rest->rest->type != T_NIL && args->rest->rest->rest->type != T_NIL))
+		return warn("hash-get requires a hash, a key and an optional default value"), nil_atom();
+	
+	hash_t *hash = eval_hash_arg(args, env, "hash-get");
+	if (hash == NULL)
+		return nil_atom();
+	atom_t *key = eval_atom(args->rest->first, env);
+	
+	atom_t *value = hash_get(hash, key);
+	if (value == NULL)
+		value = (args->rest->rest->type == T_PAIR) ? eval_atom(args->rest->rest->first, env) : nil_atom();
+	return value;
+}
+
+atom_t* buildin_hash_put(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || args->rest->rest->type != T_PAIR || args->rest->rest->rest->type != T_NIL)
+		return warn("hash-put! requires three arguments"), nil_atom();
+	
+	hash_t *hash = eval_hash_arg(args, env, "hash-put!");
+	if (hash == NULL)
+		return nil_atom();
+	atom_t *key = eval_atom(args->rest->first, env);
+	atom_t *value = eval_atom(args->rest->rest->first, env);
+	
+	hash_put(hash, key, value);
+	return value;
+}
+
+atom_t* buildin_hash_delete(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || args->rest->rest->type != T_NIL)
+		return warn("hash-delete! requires two arguments"), nil_atom();
 	
-	if (first_arg->type != T_NUM || second_arg->type != T_NUM){
-		warn("multiply only works on numbers");
+	hash_t *hash = eval_hash_arg(args, env, "hash-delete!");
+	if (hash == NULL)
 		return nil_atom();
+	
+	return hash_delete(hash, eval_atom(args->rest->first, env)) ? true_atom() : false_atom();
+}
+
+atom_t* buildin_hash_keys(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_NIL)
+		return warn("hash-keys requires exactly one argument"), nil_atom();
+	
+	hash_t *hash = eval_hash_arg(args, env, "hash-keys");
+	return (hash != NULL) ? hash_keys(hash) : nil_atom();
+}
+
+atom_t* buildin_hash_count(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_NIL)
+		return warn("hash-count requires exactly one argument"), nil_atom();
+	
+	hash_t *hash = eval_hash_arg(args, env, "hash-count");
+	return (hash != NULL) ? num_atom_alloc(hash->length) : nil_atom();
+}
+
+
+//
+// Strings
+//
+
+atom_t* buildin_string_length(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_NIL)
+		return warn("string-length requires exactly one argument"), nil_atom();
+	
+	atom_t *str = eval_atom(args->first, env);
+	if (str->type != T_STR)
+		return warn("string-length: the argument has to eval to a string"), nil_atom();
+	
+	return num_atom_alloc(str->str_length);
+}
+
+/**
+ * Evals all arguments first so the result can be allocated in one go.
+ */
+atom_t* buildin_string_append(atom_t *args, env_t *env){
+	size_t count = 0;
+	for(atom_t *arg = args; arg->type == T_PAIR; arg = arg->rest)
+		count++;
+	
+	atom_t *strs[count > 0 ? count : 1];
+	size_t length = 0, i = 0;
+	for(atom_t *arg = args; arg->type == T_PAIR; arg = arg->rest, i++){
+		strs[i] = eval_atom(arg->first, env);
+		if (strs[i]->type != T_STR)
+			return warn("string-append: all arguments have to eval to strings"), nil_atom();
+		length += strs[i]->str_length;
 	}
 	
-	return num_atom_alloc(first_arg->num * second_arg->num);
+	str_builder_t *builder = str_builder_new(length);
+	for(i = 0; i < count; i++)
+		str_builder_append(builder, strs[i]->str, strs[i]->str_length);
+	return str_builder_to_str(builder);
 }
 
-void compile_multiply(atom_t *cl, atom_t *args, env_t *env){
-	if (args->rest->type != T_PAIR || args->rest->rest->type != T_NIL){
-		warn("multiply requires two arguments");
-		bcg_gen_op(&cl->bytecode, BC_LOAD_NIL);
-		return;
+/**
+ * (substring str start [end]), the result shares the characters with `str`.
+ */
+atom_t* buildin_substring(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || (args->rest->rest->type != T_NIL && args->rest->rest->rest->type != T_NIL))
+		return warn("substring requires a string, a start and an optional end index"), nil_atom();
+	
+	atom_t *str = eval_atom(args->first, env);
+	if (str->type != T_STR)
+		return warn("substring: the first argument has to eval to a string"), nil_atom();
+	atom_t *start = eval_atom(args->rest->first, env);
+	atom_t *end = (args->rest->rest->type == T_PAIR) ? eval_atom(args->rest->rest->first, env) : num_atom_alloc(str->str_length);
+	if (start->type != T_NUM || end->type != T_NUM)
+		return warn("substring: the indices have to eval to numbers"), nil_atom();
+	if (start->num < 0 || start->num > end->num || (size_t)end->num > str->str_length)
+		return warn("substring: range %ld to %ld out of range", start->num, end->num), nil_atom();
+	
+	return str_slice(str, start->num, end->num);
+}
+
+atom_t* buildin_make_string_builder(atom_t *args, env_t *env){
+	if (args->type != T_NIL)
+		return warn("make-string-builder doesn't take any arguments"), nil_atom();
+	return str_builder_atom_alloc(str_builder_new(0));
+}
+
+/**
+ * (string-builder-append! builder str ...), returns the builder.
+ */
+atom_t* buildin_string_builder_append(atom_t *args, env_t *env){
+	if (args->type != T_PAIR)
+		return warn("string-builder-append! requires a string builder and strings"), nil_atom();
+	
+	atom_t *builder = eval_atom(args->first, env);
+	if (builder->type != T_STR_BUILDER)
+		return warn("string-builder-append!: the first argument has to eval to a string builder"), nil_atom();
+	
+	for(atom_t *arg = args->rest; arg->type == T_PAIR; arg = arg->rest){
+		atom_t *str = eval_atom(arg->first, env);
+		if (str->type != T_STR)
+			return warn("string-builder-append!: all arguments after the builder have to eval to strings"), nil_atom();
+		str_builder_append(builder->builder, str->str, str->str_length);
 	}
 	
-	bcc_compile_expr(cl, args->first, env);
-	bcc_compile_expr(cl, args->rest->first, env);
-	bcg_gen_op(&cl->bytecode, BC_MUL);
+	return builder;
 }
 
-atom_t* buildin_divide(atom_t *args, env_t *env){
-	atom_t *first_arg = eval_atom(args->first, env);
-	atom_t *second_arg = eval_atom(args->rest->first, env);
+atom_t* buildin_string_builder_to_string(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_NIL)
+		return warn("string-builder->string requires exactly one argument"), nil_atom();
 	
-	if (first_arg->type != T_NUM || second_arg->type != T_NUM){
-		warn("divide only works on numbers");
+	atom_t *builder = eval_atom(args->first, env);
+	if (builder->type != T_STR_BUILDER)
+		return warn("string-builder->string: the argument has to eval to a string builder"), nil_atom();
+	
+	return str_builder_to_str(builder->builder);
+}
+
+
+//
+// Typed arrays
+//
+
+// Defined below with the other comparison buildins
+atom_t* buildin_equal(atom_t *args, env_t *env);
+atom_t* buildin_lt(atom_t *args, env_t *env);
+atom_t* buildin_gt(atom_t *args, env_t *env);
+
+/**
+ * Evals the first argument and returns it if it's an array. Otherwise a warning is printed and
+ * NULL returned.
+ */
+static atom_t* eval_array_arg(atom_t *args, env_t *env, char *name){
+	atom_t *array = eval_atom(args->first, env);
+	if (array->type != T_ARRAY)
+		return warn("%s: the first argument has to eval to an array", name), NULL;
+	return array;
+}
+
+/**
+ * Evals both arguments and checks that they're arrays of the same kind and length. Returns false
+ * (after a warning) if not.
+ */
+static bool eval_array_pair(atom_t *args, env_t *env, char *name, atom_t **a, atom_t **b){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || args->rest->rest->type != T_NIL)
+		return warn("%s requires two arguments", name), false;
+	
+	*a = eval_atom(args->first, env);
+	*b = eval_atom(args->rest->first, env);
+	if ((*a)->type != T_ARRAY || (*b)->type != T_ARRAY)
+		return warn("%s: both arguments have to eval to arrays", name), false;
+	if ((*a)->array.kind != (*b)->array.kind || (*a)->array.length != (*b)->array.length)
+		return warn("%s: both arrays need the same type and length", name), false;
+	return true;
+}
+
+atom_t* buildin_make_array(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || (args->rest->rest->type != T_NIL && args->rest->rest->rest->type != T_NIL))
+		return warn("make-array requires a type, a length and an optional fill value"), nil_atom();
+	
+	atom_t *kind_name = eval_atom(args->first, env);
+	uint8_t kind = 0;
+	if (kind_name->type == T_SYM) {
+		if (strcmp(kind_name->sym, "i64") == 0)
+			kind = ARRAY_I64;
+		else if (strcmp(kind_name->sym, "f64") == 0)
+			kind = ARRAY_F64;
+		else if (strcmp(kind_name->sym, "u8") == 0)
+			kind = ARRAY_U8;
+	}
+	if (kind == 0)
+		return warn("make-array: the type has to eval to i64, f64 or u8"), nil_atom();
+	
+	atom_t *length = eval_atom(args->rest->first, env);
+	if (length->type != T_NUM || length->num < 0)
+		return warn("make-array: the length has to eval to a positive number"), nil_atom();
+	
+	atom_t *array = array_new(kind, length->num);
+	if (args->rest->rest->type == T_PAIR) {
+		atom_t *fill = eval_atom(args->rest->rest->first, env);
+		for(size_t i = 0; i < array->array.length; i++){
+			if ( !array_set(array, i, fill) )
+				return warn("make-array: the fill value doesn't fit into the array"), nil_atom();
+		}
+	}
+	
+	return array;
+}
+
+atom_t* buildin_array_length(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_NIL)
+		return warn("array-length requires exactly one argument"), nil_atom();
+	
+	atom_t *array = eval_array_arg(args, env, "array-length");
+	return (array != NULL) ? num_atom_alloc(array->array.length) : nil_atom();
+}
+
+atom_t* buildin_array_ref(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || args->rest->rest->type != T_NIL)
+		return warn("array-ref requires two arguments"), nil_atom();
+	
+	atom_t *array = eval_array_arg(args, env, "array-ref");
+	if (array == NULL)
 		return nil_atom();
+	atom_t *index = eval_atom(args->rest->first, env);
+	if (index->type != T_NUM || index->num < 0 || (size_t)index->num >= array->array.length)
+		return warn("array-ref: the index has to eval to a number in range"), nil_atom();
+	
+	return array_get(array, index->num);
+}
+
+atom_t* buildin_array_set(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || args->rest->rest->type != T_PAIR || args->rest->rest->rest->type != T_NIL)
+		return warn("array-set! requires three arguments"), nil_atom();
+	
+	atom_t *array = eval_array_arg(args, env, "array-set!");
+	if (array == NULL)
+		return nil_atom();
+	atom_t *index = eval_atom(args->rest->first, env);
+	atom_t *value = eval_atom(args->rest->rest->first, env);
+	if (index->type != T_NUM || index->num < 0 || (size_t)index->num >= array->array.length)
+		return warn("array-set!: the index has to eval to a number in range"), nil_atom();
+	if ( !array_set(array, index->num, value) )
+		return warn("array-set!: the value doesn't fit into the array"), nil_atom();
+	
+	return value;
+}
+
+atom_t* buildin_array_add(atom_t *args, env_t *env){
+	atom_t *a, *b;
+	return eval_array_pair(args, env, "array-add", &a, &b) ? array_add(a, b) : nil_atom();
+}
+
+atom_t* buildin_array_mul(atom_t *args, env_t *env){
+	atom_t *a, *b;
+	return eval_array_pair(args, env, "array-mul", &a, &b) ? array_mul(a, b) : nil_atom();
+}
+
+atom_t* buildin_array_dot(atom_t *args, env_t *env){
+	atom_t *a, *b;
+	return eval_array_pair(args, env, "array-dot", &a, &b) ? array_dot(a, b) : nil_atom();
+}
+
+atom_t* buildin_array_sum(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_NIL)
+		return warn("array-sum requires exactly one argument"), nil_atom();
+	
+	atom_t *array = eval_array_arg(args, env, "array-sum");
+	return (array != NULL) ? array_sum(array) : nil_atom();
+}
+
+atom_t* buildin_array_min(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_NIL)
+		return warn("array-min requires exactly one argument"), nil_atom();
+	
+	atom_t *array = eval_array_arg(args, env, "array-min");
+	return (array != NULL) ? array_min(array) : nil_atom();
+}
+
+atom_t* buildin_array_max(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_NIL)
+		return warn("array-max requires exactly one argument"), nil_atom();
+	
+	atom_t *array = eval_array_arg(args, env, "array-max");
+	return (array != NULL) ? array_max(array) : nil_atom();
+}
+
+/**
+ * (array-filter array comparator value), e.g. (array-filter a > 10). The comparator has to be
+ * one of the =, < or > buildins. They're recognized by their function so the filter runs as one
+ * loop over the unboxed elements.
+ */
+atom_t* buildin_array_filter(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || args->rest->rest->type != T_PAIR || args->rest->rest->rest->type != T_NIL)
+		return warn("array-filter requires an array, a comparator and a value"), nil_atom();
+	
+	atom_t *array = eval_array_arg(args, env, "array-filter");
+	if (array == NULL)
+		return nil_atom();
+	atom_t *comparator = eval_atom(args->rest->first, env);
+	atom_t *value = eval_atom(args->rest->rest->first, env);
+	
+	uint8_t op = 0;
+	if (comparator->type == T_BUILDIN) {
+		if (comparator->func == buildin_equal)
+			op = BC_EQ;
+		else if (comparator->func == buildin_lt)
+			op = BC_LT;
+		else if (comparator->func == buildin_gt)
+			op = BC_GT;
 	}
+	if (op == 0)
+		return warn("array-filter: the comparator has to be =, < or >"), nil_atom();
 	
-	return num_atom_alloc(first_arg->num / second_arg->num);
+	atom_t *result = array_filter(array, op, value);
+	if (result == NULL)
+		return warn("array-filter: the value can't be compared with the elements of the array"), nil_atom();
+	return result;
 }
 
-void compile_divide(atom_t *cl, atom_t *args, env_t *env){
-	if (args->rest->type != T_PAIR || args->rest->rest->type != T_NIL){
-		warn("divide requires two arguments");
-		bcg_gen_op(&cl->bytecode, BC_LOAD_NIL);
+
+
+//
+// Byte buffers and files
+//
+
+/**
+ * Evals the first argument and returns it if it's an u8 array. Otherwise a warning is printed and
+ * NULL returned.
+ */
+static atom_t* eval_buffer_arg(atom_t *args, env_t *env, char *name){
+	atom_t *buffer = eval_atom(args->first, env);
+	if (buffer->type != T_ARRAY || buffer->array.kind != ARRAY_U8)
+		return warn("%s: the first argument has to eval to an u8 array", name), NULL;
+	return buffer;
+}
+
+/**
+ * Evals the offset and integer type of buffer-ref and buffer-set!. Returns false (after a
+ * warning) if the type is unknown or the integer isn't within the buffer.
+ */
+static bool eval_buffer_int_args(atom_t *buffer, atom_t *args, env_t *env, char *name, size_t *offset, buffer_int_t *type){
+	atom_t *offset_atom = eval_atom(args->first, env);
+	atom_t *type_atom = eval_atom(args->rest->first, env);
+	if (type_atom->type != T_SYM || !buffer_parse_int_type(type_atom->sym, type))
+		return warn("%s: the type has to eval to u8, i8, u16le, i16be, ..., i64le or i64be", name), false;
+	if (offset_atom->type != T_NUM || offset_atom->num < 0 || (size_t)offset_atom->num + type->size > buffer->array.length)
+		return warn("%s: the offset has to eval to a number within the buffer", name), false;
+	*offset = offset_atom->num;
+	return true;
+}
+
+atom_t* buildin_read_file(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_NIL)
+		return warn("read-file requires exactly one argument"), nil_atom();
+	
+	atom_t *path = eval_atom(args->first, env);
+	if (path->type != T_STR)
+		return warn("read-file: the path has to eval to a string"), nil_atom();
+	
+	atom_t *buffer = buffer_read_file(str_to_cstr(path));
+	if (buffer == NULL)
+		return warn("read-file: failed to read %s: %s", str_to_cstr(path), strerror(errno)), nil_atom();
+	return buffer;
+}
+
+/**
+ * (write-file path data [append]), data is an u8 array or a string. Returns true on success.
+ */
+atom_t* buildin_write_file(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || (args->rest->rest->type != T_NIL && args->rest->rest->rest->type != T_NIL))
+		return warn("write-file requires a path, the data and an optional append flag"), nil_atom();
+	
+	atom_t *path = eval_atom(args->first, env);
+	if (path->type != T_STR)
+		return warn("write-file: the path has to eval to a string"), nil_atom();
+	atom_t *data = eval_atom(args->rest->first, env);
+	bool append = (args->rest->rest->type == T_PAIR) && eval_atom(args->rest->rest->first, env)->type == T_TRUE;
+	
+	bool written;
+	if (data->type == T_STR)
+		written = buffer_write_file(str_to_cstr(path), data->str, data->str_length, append);
+	else if (data->type == T_ARRAY && data->array.kind == ARRAY_U8)
+		written = buffer_write_file(str_to_cstr(path), data->array.data, data->array.length, append);
+	else
+		return warn("write-file: the data has to eval to an u8 array or a string"), nil_atom();
+	
+	if (!written)
+		return warn("write-file: failed to write %s: %s", str_to_cstr(path), strerror(errno)), nil_atom();
+	return true_atom();
+}
+
+/**
+ * (buffer-ref buffer offset type), e.g. (buffer-ref header 4 'u32le).
+ */
+atom_t* buildin_buffer_ref(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || args->rest->rest->type != T_PAIR || args->rest->rest->rest->type != T_NIL)
+		return warn("buffer-ref requires a buffer, an offset and a type"), nil_atom();
+	
+	atom_t *buffer = eval_buffer_arg(args, env, "buffer-ref");
+	size_t offset;
+	buffer_int_t type;
+	if ( buffer == NULL || !eval_buffer_int_args(buffer, args->rest, env, "buffer-ref", &offset, &type) )
+		return nil_atom();
+	
+	return num_atom_alloc(buffer_get_int(buffer, offset, type));
+}
+
+/**
+ * (buffer-set! buffer offset type value), stores the lower bytes of value.
+ */
+atom_t* buildin_buffer_set(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || args->rest->rest->type != T_PAIR || args->rest->rest->rest->type != T_PAIR || args->rest->rest->rest->rest->type != T_NIL)
+		return warn("buffer-set! requires a buffer, an offset, a type and a value"), nil_atom();
+	
+	atom_t *buffer = eval_buffer_arg(args, env, "buffer-set!");
+	size_t offset;
+	buffer_int_t type;
+	if ( buffer == NULL || !eval_buffer_int_args(buffer, args->rest, env, "buffer-set!", &offset, &type) )
+		return nil_atom();
+	atom_t *value = eval_atom(args->rest->rest->rest->first, env);
+	if (value->type != T_NUM)
+		return warn("buffer-set!: the value has to eval to a number"), nil_atom();
+	
+	buffer_set_int(buffer, offset, type, value->num);
+	return value;
+}
+
+/**
+ * (buffer->string buffer [start end]), copies the bytes into a new string.
+ */
+atom_t* buildin_buffer_to_string(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || (args->rest->type != T_NIL && (args->rest->rest->type != T_PAIR || args->rest->rest->rest->type != T_NIL)))
+		return warn("buffer->string requires a buffer and an optional start and end offset"), nil_atom();
+	
+	atom_t *buffer = eval_buffer_arg(args, env, "buffer->string");
+	if (buffer == NULL)
+		return nil_atom();
+	
+	int64_t start = 0, end = buffer->array.length;
+	if (args->rest->type == T_PAIR) {
+		atom_t *start_atom = eval_atom(args->rest->first, env);
+		atom_t *end_atom = eval_atom(args->rest->rest->first, env);
+		if (start_atom->type != T_NUM || end_atom->type != T_NUM)
+			return warn("buffer->string: the offsets have to eval to numbers"), nil_atom();
+		start = start_atom->num;
+		end = end_atom->num;
+	}
+	if (start < 0 || start > end || (size_t)end > buffer->array.length)
+		return warn("buffer->string: range %ld to %ld out of range", start, end), nil_atom();
+	
+	str_builder_t *builder = str_builder_new(end - start);
+	str_builder_append(builder, (char*)buffer->array.data + start, end - start);
+	return str_builder_to_str(builder);
+}
+
+atom_t* buildin_string_to_buffer(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_NIL)
+		return warn("string->buffer requires exactly one argument"), nil_atom();
+	
+	atom_t *str = eval_atom(args->first, env);
+	if (str->type != T_STR)
+		return warn("string->buffer: the argument has to eval to a string"), nil_atom();
+	
+	atom_t *buffer = array_new(ARRAY_U8, str->str_length);
+	memcpy(buffer->array.data, str->str, str->str_length);
+	return buffer;
+}
+
+
+//
+// Math
+//
+
+/**
+ * Evals the variadic arithmetic buildins. The operation is applied from left to right:
+ * (- a b c) is (a - b) - c. Without arguments the result is `identity`. With one argument
+ * it is applied to `identity`, e.g. (- a) is 0 - a. `op` is the bytecode of the operation.
+ */
+static atom_t* eval_arithmetic(atom_t *args, env_t *env, char *name, uint8_t op, int64_t identity, bool requires_arg){
+	if (requires_arg && args->type != T_PAIR)
+		return warn("%s requires at least one argument", name), nil_atom();
+	
+	atom_t *result = num_atom_alloc(identity);
+	size_t arg_count = 0;
+	for(atom_t *pair = args; pair->type == T_PAIR; pair = pair->rest, arg_count++){
+		atom_t *arg = eval_atom(pair->first, env);
+		if ( !is_num_atom(arg) )
+			return warn("%s only works on numbers", name), nil_atom();
+		
+		// The first argument is the start value if there are others
+		if (arg_count == 0 && pair->rest->type == T_PAIR) {
+			result = arg;
+			continue;
+		}
+		
+		switch(op){
+			case BC_ADD: result = num_add(result, arg); break;
+			case BC_SUB: result = num_sub(result, arg); break;
+			case BC_MUL: result = num_mul(result, arg); break;
+			case BC_DIV:
+				if (arg->type == T_NUM && arg->num == 0)
+					return warn("division by zero"), nil_atom();
+				result = num_div(result, arg);
+				break;
+		}
+	}
+	
+	return result;
+}
+
+/**
+ * Compiles the variadic arithmetic buildins into a chain of binary operations. The first arg is
+ * the start value (or `identity` if there's only one arg or none at all).
+ */
+static void compile_arithmetic(atom_t *cl, atom_t *args, env_t *env, char *name, uint8_t op, int64_t identity, bool requires_arg){
+	if (requires_arg && args->type != T_PAIR){
+		warn("%s requires at least one argument", name);
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
 		return;
 	}
 	
-	bcc_compile_expr(cl, args->first, env);
-	bcc_compile_expr(cl, args->rest->first, env);
-	bcg_gen_op(&cl->bytecode, BC_DIV);
+	// (+ a) and (* a) are just a, no need to apply the operation to the identity
+	atom_t *rest_args = args;
+	if ( args->type == T_PAIR && (args->rest->type == T_PAIR || op == BC_ADD || op == BC_MUL) ) {
+		bcc_compile_expr(cl, args->first, env);
+		rest_args = args->rest;
+	} else {
+		bcg_gen(&cl->comp_data->bytecode, (instruction_t){BC_LOAD_NUM, .num = identity});
+	}
+	
+	for(atom_t *pair = rest_args; pair->type == T_PAIR; pair = pair->rest){
+		bcc_compile_expr(cl, pair->first, env);
+		bcg_gen_op(&cl->comp_data->bytecode, op);
+	}
+}
+
+atom_t* buildin_plus(atom_t *args, env_t *env){
+	return eval_arithmetic(args, env, "plus", BC_ADD, 0, false);
+}
+
+void compile_plus(atom_t *cl, atom_t *args, env_t *env){
+	compile_arithmetic(cl, args, env, "plus", BC_ADD, 0, false);
+}
+
+atom_t* buildin_minus(atom_t *args, env_t *env){
+	return eval_arithmetic(args, env, "minus", BC_SUB, 0, true);
+}
+
+void compile_minus(atom_t *cl, atom_t *args, env_t *env){
+	compile_arithmetic(cl, args, env, "minus", BC_SUB, 0, true);
+}
+
+atom_t* buildin_multiply(atom_t *args, env_t *env){
+	return eval_arithmetic(args, env, "multiply", BC_MUL, 1, false);
+}
+
+void compile_multiply(atom_t *cl, atom_t *args, env_t *env){
+	compile_arithmetic(cl, args, env, "multiply", BC_MUL, 1, false);
+}
+
+atom_t* buildin_divide(atom_t *args, env_t *env){
+	return eval_arithmetic(args, env, "divide", BC_DIV, 1, true);
+}
+
+void compile_divide(atom_t *cl, atom_t *args, env_t *env){
+	compile_arithmetic(cl, args, env, "divide", BC_DIV, 1, true);
 }
 
 atom_t* buildin_modulo(atom_t *args, env_t *env){
+	if (args->type != T_PAIR || args->rest->type != T_PAIR || args->rest->rest->type != T_NIL)
+		return warn("modulo requires two arguments"), nil_atom();
+	
 	atom_t *first_arg = eval_atom(args->first, env);
 	atom_t *second_arg = eval_atom(args->rest->first, env);
 	
-	if (first_arg->type != T_NUM || second_arg->type != T_NUM){
+	if ( !is_num_atom(first_arg) || !is_num_atom(second_arg) ){
 		warn("modulo only works on numbers");
 		return nil_atom();
 	}
 	
-	return num_atom_alloc(first_arg->num % second_arg->num);
+	if (second_arg->type == T_NUM && second_arg->num == 0){
+		warn("modulo by zero");
+		return nil_atom();
+	}
+	
+	return num_mod(first_arg, second_arg);
 }
 
 void compile_modulo(atom_t *cl, atom_t *args, env_t *env){
 	if (args->rest->type != T_PAIR || args->rest->rest->type != T_NIL){
 		warn("modulo requires two arguments");
-		bcg_gen_op(&cl->bytecode, BC_LOAD_NIL);
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
 		return;
 	}
 	
 	bcc_compile_expr(cl, args->first, env);
 	bcc_compile_expr(cl, args->rest->first, env);
-	bcg_gen_op(&cl->bytecode, BC_MOD);
+	bcg_gen_op(&cl->comp_data->bytecode, BC_MOD);
 }
 
 
@@ -427,67 +1633,123 @@ void compile_modulo(atom_t *cl, atom_t *args, env_t *env){
 // Comperators
 //
 
-atom_t* buildin_equal(atom_t *args, env_t *env){
-	atom_t *first_arg = eval_atom(args->first, env);
-	atom_t *second_arg = eval_atom(args->rest->first, env);
+/**
+ * Evals the variadic comparison buildins. Each argument is compared with the next one, e.g.
+ * (< a b c) is true if a < b and b < c. The arguments are evaluated from left to right until
+ * the first comparison fails.
+ */
+static atom_t* eval_comparison(atom_t *args, env_t *env, char *name, uint8_t op){
+	if (args->type != T_PAIR)
+		return warn("%s requires at least one argument", name), nil_atom();
 	
-	if (first_arg->type != T_NUM || second_arg->type != T_NUM){
-		warn("eqal only works on numbers");
-		return nil_atom();
+	atom_t *prev_arg = eval_atom(args->first, env);
+	if ( !is_num_atom(prev_arg) )
+		return warn("%s only works on numbers", name), nil_atom();
+	
+	for(atom_t *pair = args->rest; pair->type == T_PAIR; pair = pair->rest){
+		atom_t *arg = eval_atom(pair->first, env);
+		if ( !is_num_atom(arg) )
+			return warn("%s only works on numbers", name), nil_atom();
+		
+		bool result = false;
+		switch(op){
+			case BC_EQ: result = (num_cmp(prev_arg, arg) == 0); break;
+			case BC_LT: result = (num_cmp(prev_arg, arg) == -1); break;
+			case BC_GT: result = (num_cmp(prev_arg, arg) == 1); break;
+		}
+		if (!result)
+			return false_atom();
+		prev_arg = arg;
 	}
 	
-	if (first_arg->num == second_arg->num)
-		return true_atom();
-	else
-		return false_atom();
+	return true_atom();
 }
 
-void compile_equal(atom_t *cl, atom_t *args, env_t *env){
+/**
+ * Compiles the variadic comparison buildins. With more than two arguments each argument except
+ * the first and last one is kept in a hidden local since it's needed for two comparisons. Code
+ * for (< a b c):
+ * 	a, b, STORE_LOCAL tmp, LT, JUMP_IF_FALSE false_case
+ * 	LOAD_LOCAL tmp, c, LT, JUMP end
+ * 	false_case: LOAD_FALSE
+ * 	end:
+ */
+static void compile_comparison(atom_t *cl, atom_t *args, env_t *env, char *name, uint8_t op){
+	if (args->type != T_PAIR){
+		warn("%s requires at least one argument", name);
+		bcg_gen_op(&cl->comp_data->bytecode, BC_LOAD_NIL);
+		return;
+	}
+	
+	bytecode_t *bc = &cl->comp_data->bytecode;
 	bcc_compile_expr(cl, args->first, env);
-	bcc_compile_expr(cl, args->rest->first, env);
-	bcg_gen_op(&cl->bytecode, BC_EQ);
-}
-
-atom_t* buildin_lt(atom_t *args, env_t *env){
-	atom_t *first_arg = eval_atom(args->first, env);
-	atom_t *second_arg = eval_atom(args->rest->first, env);
+	if (args->rest->type != T_PAIR) {
+		// Nothing to compare with
+		bcg_gen_op(bc, BC_DROP);
+		bcg_gen_op(bc, BC_LOAD_TRUE);
+		return;
+	}
 	
-	if (first_arg->type != T_NUM || second_arg->type != T_NUM){
-		warn("lt only works on numbers");
-		return nil_atom();
+	size_t arg_count = 0;
+	for(atom_t *pair = args; pair->type == T_PAIR; pair = pair->rest)
+		arg_count++;
+	if (arg_count == 2) {
+		bcc_compile_expr(cl, args->rest->first, env);
+		bcg_gen_op(bc, op);
+		return;
 	}
 	
-	if (first_arg->num < second_arg->num)
-		return true_atom();
-	else
-		return false_atom();
+	size_t tmp = bcc_alloc_temp(cl);
+	size_t false_jumps[arg_count - 2];
+	size_t i = 0;
+	for(atom_t *pair = args->rest; pair->rest->type == T_PAIR; pair = pair->rest, i++){
+		if (i > 0)
+			bcg_gen(bc, (instruction_t){BC_LOAD_LOCAL, .index = tmp, .offset = 0});
+		bcc_compile_expr(cl, pair->first, env);
+		bcg_gen(bc, (instruction_t){BC_STORE_LOCAL, .index = tmp, .offset = 0});
+		bcg_gen_op(bc, op);
+		false_jumps[i] = bcg_gen(bc, (instruction_t){BC_JUMP_IF_FALSE, .jump_offset = 0});
+	}
+	
+	// The last comparison results in the value of the entire expression
+	atom_t *last_arg = args;
+	while(last_arg->rest->type == T_PAIR)
+		last_arg = last_arg->rest;
+	bcg_gen(bc, (instruction_t){BC_LOAD_LOCAL, .index = tmp, .offset = 0});
+	bcc_compile_expr(cl, last_arg->first, env);
+	bcg_gen_op(bc, op);
+	size_t end_jump = bcg_gen(bc, (instruction_t){BC_JUMP, .jump_offset = 0});
+	
+	for(i = 0; i < arg_count - 2; i++)
+		bcg_backpatch_target_in(bc, false_jumps[i]);
+	bcg_gen_op(bc, BC_LOAD_FALSE);
+	bcg_backpatch_target_in(bc, end_jump);
+	
+	bcc_release_temp(cl, tmp);
+}
+
+atom_t* buildin_equal(atom_t *args, env_t *env){
+	return eval_comparison(args, env, "equal", BC_EQ);
+}
+
+void compile_equal(atom_t *cl, atom_t *args, env_t *env){
+	compile_comparison(cl, args, env, "equal", BC_EQ);
+}
+
+atom_t* buildin_lt(atom_t *args, env_t *env){
+	return eval_comparison(args, env, "lt", BC_LT);
 }
 
 void compile_lt(atom_t *cl, atom_t *args, env_t *env){
-	bcc_compile_expr(cl, args->first, env);
-	bcc_compile_expr(cl, args->rest->first, env);
-	bcg_gen_op(&cl->bytecode, BC_LT);
+	compile_comparison(cl, args, env, "lt", BC_LT);
 }
 
 atom_t* buildin_gt(atom_t *args, env_t *env){
-	atom_t *first_arg = eval_atom(args->first, env);
-	atom_t *second_arg = eval_atom(args->rest->first, env);
-	
-	if (first_arg->type != T_NUM || second_arg->type != T_NUM){
-		warn("gt only works on numbers");
-		return nil_atom();
-	}
-	
-	if (first_arg->num > second_arg->num)
-		return true_atom();
-	else
-		return false_atom();
+	return eval_comparison(args, env, "gt", BC_GT);
 }
 
 void compile_gt(atom_t *cl, atom_t *args, env_t *env){
-	bcc_compile_expr(cl, args->first, env);
-	bcc_compile_expr(cl, args->rest->first, env);
-	bcg_gen_op(&cl->bytecode, BC_GT);
+	compile_comparison(cl, args, env, "gt", BC_GT);
 }
 
 
@@ -499,16 +1761,17 @@ typedef atom_t* (*mod_init_func_t)(env_t *env);
 
 atom_t* buildin_mod_load(atom_t *args, env_t *env){
 	atom_t *name_atom = eval_atom(args->first, env);
-	void *shared_obj = dlopen(name_atom->str, RTLD_LAZY);
+	char *name = str_to_cstr(name_atom);
+	void *shared_obj = dlopen(name, RTLD_LAZY);
 	
 	if (shared_obj == NULL){
-		warn("Failed to load module %s: %s", name_atom->str, dlerror());
+		warn("Failed to load module %s: %s", name, dlerror());
 		return nil_atom();
 	}
 	
 	mod_init_func_t init = dlsym(shared_obj, "init");
 	if (init == NULL){
-		warn("Module %s does not have an init function, aborting load", name_atom->str);
+		warn("Module %s does not have an init function, aborting load", name);
 		dlclose(shared_obj);
 		return nil_atom();
 	}
@@ -525,11 +1788,19 @@ atom_t* buildin_print(atom_t *args, env_t *env){
 	atom_t *atom = eval_atom(args->first, env);
 	switch(atom->type){
 		case T_STR:
-			printf("%s\n", atom->str);
+			printf("%.*s\n", (int)atom->str_length, atom->str);
 			break;
 		case T_NUM:
 			printf("%ld\n", atom->num);
 			break;
+		case T_BIGNUM:
+			printf("%s\n", bignum_to_str(atom->bignum));
+			break;
+		case T_FLOAT: {
+			char buffer[32];
+			format_float(buffer, sizeof(buffer), atom->real);
+			printf("%s\n", buffer);
+			} break;
 		case T_NIL:
 			printf("nil\n");
 			break;
@@ -552,28 +1823,88 @@ atom_t* gc_heap_size_eval(atom_t *args, env_t *env){
 }
 
 
+static atom_t* pure(atom_t *buildin){
+	buildin->buildin_flags |= BUILDIN_PURE;
+	return buildin;
+}
+
 void register_buildins_in(env_t *env){
 	env_def(env, "define", buildin_atom_alloc(buildin_define, compile_define));
 	env_def(env, "set!", buildin_atom_alloc(set_eval, set_compile));
 	
 	env_def(env, "if", buildin_atom_alloc(buildin_if, compile_if));
+	env_def(env, "while", buildin_atom_alloc(buildin_while, compile_while));
 	env_def(env, "quote", buildin_atom_alloc(buildin_quote, compile_quote));
 	env_def(env, "begin", buildin_atom_alloc(buildin_begin, compile_begin));
 	env_def(env, "lambda", buildin_atom_alloc(buildin_lambda, compile_lambda));
+	env_def(env, "let", buildin_atom_alloc(buildin_let, compile_let));
+	env_def(env, "let*", buildin_atom_alloc(buildin_let_star, compile_let_star));
+	env_def(env, "apply", buildin_atom_alloc(buildin_apply, compile_apply));
 	
 	env_def(env, "cons", buildin_atom_alloc(buildin_cons, compile_cons));
 	env_def(env, "first", buildin_atom_alloc(buildin_first, compile_first));
 	env_def(env, "rest", buildin_atom_alloc(buildin_rest, compile_rest));
 	
-	env_def(env, "+", buildin_atom_alloc(buildin_plus, compile_plus));
-	env_def(env, "-", buildin_atom_alloc(buildin_minus, compile_minus));
-	env_def(env, "*", buildin_atom_alloc(buildin_multiply, compile_multiply));
-	env_def(env, "/", buildin_atom_alloc(buildin_divide, compile_divide));
-	env_def(env, "%", buildin_atom_alloc(buildin_modulo, compile_modulo));
+	env_def(env, "map", buildin_atom_alloc(buildin_map, NULL));
+	env_def(env, "filter", buildin_atom_alloc(buildin_filter, NULL));
+	env_def(env, "reduce", buildin_atom_alloc(buildin_reduce, NULL));
+	env_def(env, "for-each", buildin_atom_alloc(buildin_for_each, NULL));
+	env_def(env, "length", buildin_atom_alloc(buildin_length, NULL));
+	env_def(env, "reverse", buildin_atom_alloc(buildin_reverse, NULL));
+	env_def(env, "append", buildin_atom_alloc(buildin_append, NULL));
+	env_def(env, "sort", buildin_atom_alloc(buildin_sort, NULL));
+	env_def(env, "future", buildin_atom_alloc(buildin_future, NULL));
+	env_def(env, "touch", buildin_atom_alloc(buildin_touch, NULL));
+	env_def(env, "await", buildin_atom_alloc(buildin_touch, NULL));
+	env_def(env, "pmap", buildin_atom_alloc(buildin_pmap, NULL));
+	
+	env_def(env, "make-vector", buildin_atom_alloc(buildin_make_vector, NULL));
+	env_def(env, "vector-length", buildin_atom_alloc(buildin_vector_length, NULL));
+	env_def(env, "vector-ref", buildin_atom_alloc(buildin_vector_ref, compile_vector_ref));
+	env_def(env, "vector-set!", buildin_atom_alloc(buildin_vector_set, compile_vector_set));
+	
+	env_def(env, "make-hash", buildin_atom_alloc(buildin_make_hash, NULL));
+	env_def(env, "hash-get", buildin_atom_alloc(buildin_hash_get, NULL));
+	env_def(env, "hash-put!", buildin_atom_alloc(buildin_hash_put, NULL));
+	env_def(env, "hash-delete!", buildin_atom_alloc(buildin_hash_delete, NULL));
+	env_def(env, "hash-keys", buildin_atom_alloc(buildin_hash_keys, NULL));
+	env_def(env, "hash-count", buildin_atom_alloc(buildin_hash_count, NULL));
+	
+	env_def(env, "string-length", buildin_atom_alloc(buildin_string_length, NULL));
+	env_def(env, "string-append", buildin_atom_alloc(buildin_string_append, NULL));
+	env_def(env, "substring", buildin_atom_alloc(buildin_substring, NULL));
+	env_def(env, "make-string-builder", buildin_atom_alloc(buildin_make_string_builder, NULL));
+	env_def(env, "string-builder-append!", buildin_atom_alloc(buildin_string_builder_append, NULL));
+	env_def(env, "string-builder->string", buildin_atom_alloc(buildin_string_builder_to_string, NULL));
+	
+	env_def(env, "make-array", buildin_atom_alloc(buildin_make_array, NULL));
+	env_def(env, "array-length", buildin_atom_alloc(buildin_array_length, NULL));
+	env_def(env, "array-ref", buildin_atom_alloc(buildin_array_ref, NULL));
+	env_def(env, "array-set!", buildin_atom_alloc(buildin_array_set, NULL));
+	env_def(env, "array-add", buildin_atom_alloc(buildin_array_add, NULL));
+	env_def(env, "array-mul", buildin_atom_alloc(buildin_array_mul, NULL));
+	env_def(env, "array-dot", buildin_atom_alloc(buildin_array_dot, NULL));
+	env_def(env, "array-sum", buildin_atom_alloc(buildin_array_sum, NULL));
+	env_def(env, "array-min", buildin_atom_alloc(buildin_array_min, NULL));
+	env_def(env, "array-max", buildin_atom_alloc(buildin_array_max, NULL));
+	env_def(env, "array-filter", buildin_atom_alloc(buildin_array_filter, NULL));
+	
+	env_def(env, "read-file", buildin_atom_alloc(buildin_read_file, NULL));
+	env_def(env, "write-file", buildin_atom_alloc(buildin_write_file, NULL));
+	env_def(env, "buffer-ref", buildin_atom_alloc(buildin_buffer_ref, NULL));
+	env_def(env, "buffer-set!", buildin_atom_alloc(buildin_buffer_set, NULL));
+	env_def(env, "buffer->string", buildin_atom_alloc(buildin_buffer_to_string, NULL));
+	env_def(env, "string->buffer", buildin_atom_alloc(buildin_string_to_buffer, NULL));
+	
+	env_def(env, "+", pure(buildin_atom_alloc(buildin_plus, compile_plus)));
+	env_def(env, "-", pure(buildin_atom_alloc(buildin_minus, compile_minus)));
+	env_def(env, "*", pure(buildin_atom_alloc(buildin_multiply, compile_multiply)));
+	env_def(env, "/", pure(buildin_atom_alloc(buildin_divide, compile_divide)));
+	env_def(env, "%", pure(buildin_atom_alloc(buildin_modulo, compile_modulo)));
 	
-	env_def(env, "=", buildin_atom_alloc(buildin_equal, compile_equal));
-	env_def(env, "<", buildin_atom_alloc(buildin_lt, compile_lt));
-	env_def(env, ">", buildin_atom_alloc(buildin_gt, compile_gt));
+	env_def(env, "=", pure(buildin_atom_alloc(buildin_equal, compile_equal)));
+	env_def(env, "<", pure(buildin_atom_alloc(buildin_lt, compile_lt)));
+	env_def(env, ">", pure(buildin_atom_alloc(buildin_gt, compile_gt)));
 	
 	env_def(env, "mod_load", buildin_atom_alloc(buildin_mod_load, NULL));
 	
@@ -111,16 +111,81 @@ typedef struct {
  * that are needed for proper argument and local lookups. The result can be seen as an living
  * instance of the compiled lambda. The runtime lambda is pushed on top of the stack.
  * 
+ * The variables listed in the captures of the compiled lambda are copied from the current frame
+ * (or the captured variables of the current runtime lambda) into the new runtime lambda.
+ * 
  * Instruction properties used:
  * 	frame_offset (number of parents to got up for the literal table)
  * 	index (entry of the literal table to push on the stack)
  */
 #define BC_LOAD_LAMBDA	30
 
+/**
+ * Pushes a variable captured by the current runtime lambda on the stack. The captured variables
+ * are copied into the runtime lambda by BC_LOAD_LAMBDA (flat closures).
+ * Instruction properties used:
+ * 	index (index of the captured variable)
+ */
+#define BC_LOAD_CAPTURED	31
+
+/**
+ * Same as BC_LOAD_CAPTURED but the captured variable is a box (a captured local). The value in
+ * the box is pushed on the stack.
+ * Instruction properties used:
+ * 	index (index of the captured variable)
+ */
+#define BC_LOAD_BOXED_CAPTURED	32
+
+/**
+ * Stores the top of the stack in the box of a captured variable. The atom is NOT popped! It's
+ * left on the stack as the return value of `set!()`.
+ * Instruction properties used:
+ * 	index (index of the captured variable)
+ */
+#define BC_STORE_BOXED_CAPTURED	33
+
+/**
+ * Load and store instructions for local variables that are captured by nested lambdas. These
+ * locals are stored in boxes. The box is shared with the lambdas and the instructions work on
+ * the value inside the box. The stored atom is NOT popped.
+ * Instruction properties used:
+ * 	index (index of the local variable)
+ */
+#define BC_LOAD_BOXED_LOCAL	34
+#define BC_STORE_BOXED_LOCAL	35
+
+/**
+ * Puts a new box with the top of the stack in it into a local variable. The atom is NOT popped.
+ * The compiler puts these at the start of a lambda for all of its boxed locals.
+ * Instruction properties used:
+ * 	index (index of the local variable)
+ */
+#define BC_BOX_LOCAL		36
+
+/**
+ * Guard of an inlined call. The literal is a number with the index of the binding of the inlined
+ * lambda in the definition env (upper 32 bits) and the version of that binding at compile time
+ * (lower 32 bits). If the binding has a different version now it was changed since the call was
+ * inlined. Then the offset property is added to the instruction pointer to jump to the code that
+ * does a normal call.
+ * Instruction properties used:
+ * 	index (entry of the literal table with the binding index and version)
+ * 	offset (jump offset to the normal call)
+ */
+#define BC_GUARD_INLINED	37
+
 /**
  * Uses the num property as the number of arguments that are pushed on the stack.
  */
 #define BC_CALL			12
+
+/**
+ * Like BC_CALL but the last of the num arguments is a list. Its elements are pushed as
+ * individual arguments before the call. Used by `apply`.
+ * Instruction properties used:
+ * 	num (number of arguments on the stack, including the list)
+ */
+#define BC_APPLY			41
 #define BC_RETURN			13
 
 #define BC_JUMP			14
@@ -148,4 +213,21 @@ typedef struct {
 #define BC_FIRST			28
 #define BC_REST			29
 
+/**
+ * Vector access. BC_VREF pops an index and a vector and pushes the element at that index.
+ * BC_VSET pops a value, an index and a vector, stores the value in the vector and pushes the
+ * value again. Both push nil if the index is out of range.
+ * Instruction properties used: none
+ */
+#define BC_VREF			38
+#define BC_VSET			39
+
+/**
+ * Pushes a list of the arguments after the first `index` arguments of the current frame. Lambdas
+ * with a rest parameter use it to initialize the local of the parameter.
+ * Instruction properties used:
+ * 	index (number of fixed arguments)
+ */
+#define BC_LOAD_REST		40
+
 #endif
\ No newline at end of file
@@ -12,6 +12,9 @@
 
 
 void compile_statement(atom_t *cl_atom, atom_t *lambda_args, atom_t *ast, env_t *env);
+static void box_captured_locals(atom_t *cl);
+static bool compile_inlined_call(atom_t *cl, atom_t *expr, env_t *env);
+static bool local_used(atom_t *cl, size_t local_index, size_t start);
 
 /**
  * Compiles an expression into a compiled lamba atom.
@@ -25,18 +28,40 @@ atom_t* bcc_compile_to_lambda(atom_t *arg_names, atom_t *body, env_t *env, atom_
 	cl->comp_data->parent = parent_cl;
 	
 	// Put the arg names into the names array
-	for(atom_t *atom = arg_names; atom->type == T_PAIR; atom = atom->rest)
+	atom_t *atom = arg_names;
+	for(; atom->type == T_PAIR; atom = atom->rest)
 		cl->comp_data->arg_count++;
+	atom_t *rest_name = atom;
 	cl->comp_data->names = gc_alloc(cl->comp_data->arg_count * sizeof(cl->comp_data->names[0]));
 	size_t i = 0;
-	for(atom_t *atom = arg_names; atom->type == T_PAIR; atom = atom->rest){
+	for(atom = arg_names; atom->type == T_PAIR; atom = atom->rest){
 		assert(atom->first->type == T_SYM);
 		cl->comp_data->names[i] = atom->first->sym;
 		i++;
 	}
 	
+	// The rest parameter of (a b . rest) or (lambda rest ...) is a local. The prologue initializes
+	// it with the list of the extra arguments. It's removed again if the body doesn't use the
+	// parameter, then the extra arguments stay on the stack and no list is built.
+	size_t rest_local = 0;
+	if (rest_name->type == T_SYM) {
+		cl->comp_data->has_rest = true;
+		rest_local = bcc_alloc_local(cl, rest_name->sym);
+		bcg_gen(&cl->comp_data->bytecode, (instruction_t){BC_LOAD_REST, .index = cl->comp_data->arg_count});
+		bcg_gen(&cl->comp_data->bytecode, (instruction_t){BC_STORE_LOCAL, .index = rest_local, .offset = 0});
+		bcg_gen_op(&cl->comp_data->bytecode, BC_DROP);
+	}
+	
 	bcc_compile_expr(cl, body, env);
-	bcg_gen_op(&cl->bytecode, BC_RETURN);
+	bcg_gen_op(&cl->comp_data->bytecode, BC_RETURN);
+	bool rest_used = cl->comp_data->has_rest && local_used(cl, rest_local, 3);
+	box_captured_locals(cl);
+	if (cl->comp_data->has_rest && !rest_used) {
+		// The boxing prologue doesn't touch the rest local since it's not used
+		size_t prologue_length = (cl->comp_data->boxed_count > 0) ? cl->comp_data->boxed_count + 2 : 0;
+		bcg_remove(&cl->comp_data->bytecode, prologue_length, 3);
+	}
+	compiled_lambda_analyze(cl);
 	
 	return cl;
 }
@@ -44,55 +69,58 @@ atom_t* bcc_compile_to_lambda(atom_t *arg_names, atom_t *body, env_t *env, atom_
 void bcc_compile_expr(atom_t *cl_atom, atom_t *expr, env_t *env){
 	switch (expr->type) {
 		case T_NIL:
-			bcg_gen_op(&cl_atom->bytecode, BC_LOAD_NIL);
+			bcg_gen_op(&cl_atom->comp_data->bytecode, BC_LOAD_NIL);
 			break;
 		case T_TRUE:
-			bcg_gen_op(&cl_atom->bytecode, BC_LOAD_TRUE);
+			bcg_gen_op(&cl_atom->comp_data->bytecode, BC_LOAD_TRUE);
 			break;
 		case T_FALSE:
-			bcg_gen_op(&cl_atom->bytecode, BC_LOAD_FALSE);
+			bcg_gen_op(&cl_atom->comp_data->bytecode, BC_LOAD_FALSE);
 			break;
 		case T_NUM:
 			if (expr->num > INT16_MAX || expr->num < INT16_MIN) {
 				size_t idx = bcc_add_atom_to_literal_table(cl_atom, expr);
-				bcg_gen(&cl_atom->bytecode, (instruction_t){BC_LOAD_LITERAL, .index = idx, .offset = 0});
+				bcg_gen(&cl_atom->comp_data->bytecode, (instruction_t){BC_LOAD_LITERAL, .index = idx, .offset = 0});
 			} else {
-				bcg_gen(&cl_atom->bytecode, (instruction_t){BC_LOAD_NUM, .num = expr->num});
+				bcg_gen(&cl_atom->comp_data->bytecode, (instruction_t){BC_LOAD_NUM, .num = expr->num});
 			}
 			break;
-		case T_STR: {
+		case T_BIGNUM: case T_FLOAT: case T_STR: case T_VECTOR: case T_ARRAY: {
 			size_t idx = bcc_add_atom_to_literal_table(cl_atom, expr);
-			bcg_gen(&cl_atom->bytecode, (instruction_t){BC_LOAD_LITERAL, .index = idx});
+			bcg_gen(&cl_atom->comp_data->bytecode, (instruction_t){BC_LOAD_LITERAL, .index = idx});
 			} break;
 		case T_SYM: {
 			ssize_t idx;
-			size_t scope_offset = 0;
-			atom_t *current_cl = cl_atom;
-			do {
-				if ( (idx = bcc_symbol_in_names(current_cl, expr)) != -1 ) {
-					// symbol is known in current scope (lambda)
-					if (idx < current_cl->comp_data->arg_count) {
-						// symbol identifies an argument, generate a push-arg instruction
-						bcg_gen(&cl_atom->bytecode, (instruction_t){BC_LOAD_ARG, .index = idx, .offset = scope_offset});
-					} else {
-						// symbol identifies a local variable, generate a push-var instruction
-						idx = idx - current_cl->comp_data->arg_count;
-						bcg_gen(&cl_atom->bytecode, (instruction_t){BC_LOAD_LOCAL, .index = idx, .offset = scope_offset});
-					}
-					break;
+			if ( (idx = bcc_symbol_in_names(cl_atom, expr)) != -1 ) {
+				// symbol is known in current scope (lambda)
+				if (idx < cl_atom->comp_data->arg_count) {
+					// symbol identifies an argument, generate a push-arg instruction
+					bcg_gen(&cl_atom->comp_data->bytecode, (instruction_t){BC_LOAD_ARG, .index = idx, .offset = 0});
+				} else {
+					// symbol identifies a local variable, generate a push-var instruction (changed to the boxed
+					// version at the end of the compilation if a nested lambda captures the local)
+					idx = idx - cl_atom->comp_data->arg_count;
+					bcg_gen(&cl_atom->comp_data->bytecode, (instruction_t){BC_LOAD_LOCAL, .index = idx, .offset = 0});
 				}
-				scope_offset++;
-				current_cl = current_cl->comp_data->parent;
-			} while(current_cl);
-			
-			if (current_cl == NULL){
+			} else if ( (idx = bcc_capture(cl_atom, expr)) != -1 ) {
+				// symbol is a variable of an outer lambda, it's captured when this lambda is created
+				uint8_t op = cl_atom->comp_data->captures[idx].boxed ? BC_LOAD_BOXED_CAPTURED : BC_LOAD_CAPTURED;
+				bcg_gen(&cl_atom->comp_data->bytecode, (instruction_t){op, .index = idx});
+			} else {
 				// Symbol not found in any argument or variable lists of all parents, do an env lookup
 				size_t literal_idx = bcc_add_atom_to_literal_table(cl_atom, expr);
-				bcg_gen(&cl_atom->bytecode, (instruction_t){BC_LOAD_ENV, .index = literal_idx, .offset = 0});
+				bcg_gen(&cl_atom->comp_data->bytecode, (instruction_t){BC_LOAD_ENV, .index = literal_idx, .offset = 0});
 			}
 			
 			} break;
 		case T_PAIR: {
+			// Calls of pure buildins with constant arguments are evaluated right away
+			atom_t *constant = bcc_fold_constant(cl_atom, expr, env);
+			if (constant != NULL) {
+				bcc_compile_expr(cl_atom, constant, env);
+				break;
+			}
+			
 			atom_t *function_slot = expr->first;
 			if (function_slot->type == T_SYM) {
 				atom_t *looked_up_function_slot = env_get(env, function_slot->sym);
@@ -102,6 +130,9 @@ void bcc_compile_expr(atom_t *cl_atom, atom_t *expr, env_t *env){
 				}
 			}
 			
+			if ( compile_inlined_call(cl_atom, expr, env) )
+				break;
+			
 			// compile function slot
 			// compile args from left to right
 			// generate function call
@@ -111,7 +142,7 @@ void bcc_compile_expr(atom_t *cl_atom, atom_t *expr, env_t *env){
 				bcc_compile_expr(cl_atom, atom->first, env);
 				arg_count++;
 			}
-			bcg_gen(&cl_atom->bytecode, (instruction_t){BC_CALL, .num = arg_count});
+			bcg_gen(&cl_atom->comp_data->bytecode, (instruction_t){BC_CALL, .num = arg_count});
 			
 			} break;
 		default:
@@ -121,18 +152,366 @@ void bcc_compile_expr(atom_t *cl_atom, atom_t *expr, env_t *env){
 }
 
 
+/**
+ * Tries to evaluate `expr` at compile time. Self evaluating atoms (numbers, strings, nil, true and
+ * false) are constants. Calls of pure buildins (see BUILDIN_PURE) are evaluated if all their
+ * arguments are constants and the result is a self evaluating atom again. Calls that fail (the
+ * buildin returns nil) are not folded and their warnings are dropped. The code might never run
+ * and if it does the warning has to show up then.
+ * 
+ * Returns the value of `expr` or NULL if it's not a constant.
+ */
+atom_t* bcc_fold_constant(atom_t *cl_atom, atom_t *expr, env_t *env){
+	switch(expr->type){
+		case T_NUM: case T_BIGNUM: case T_FLOAT: case T_STR: case T_NIL: case T_TRUE: case T_FALSE:
+			return expr;
+		case T_PAIR:
+			break;
+		default:
+			return NULL;
+	}
+	
+	if (expr->first->type != T_SYM)
+		return NULL;
+	atom_t *buildin = env_get(env, expr->first->sym);
+	if (buildin == NULL || buildin->type != T_BUILDIN || !(buildin->buildin_flags & BUILDIN_PURE))
+		return NULL;
+	
+	// Build an argument list of the folded arguments. Since they're self evaluating the buildin
+	// can eval them again without problems.
+	atom_t *args = nil_atom(), **next_arg = &args;
+	for(atom_t *pair = expr->rest; pair->type == T_PAIR; pair = pair->rest){
+		atom_t *arg = bcc_fold_constant(cl_atom, pair->first, env);
+		if (arg == NULL)
+			return NULL;
+		*next_arg = pair_atom_alloc(arg, nil_atom());
+		next_arg = &(*next_arg)->rest;
+	}
+	
+	bool was_muted = log_mute(true);
+	atom_t *result = buildin->func(args, env);
+	log_mute(was_muted);
+	switch(result->type){
+		case T_NUM: case T_BIGNUM: case T_FLOAT: case T_STR: case T_TRUE: case T_FALSE:
+			return result;
+		default:
+			return NULL;
+	}
+}
+
 size_t bcc_add_atom_to_literal_table(atom_t *cl_atom, atom_t *subject){
-	cl_atom->literal_table.length++;
-	cl_atom->literal_table.atoms = gc_realloc(cl_atom->literal_table.atoms, cl_atom->literal_table.length * sizeof(atom_t*));
-	cl_atom->literal_table.atoms[cl_atom->literal_table.length - 1] = subject;
-	return cl_atom->literal_table.length - 1;
+	cl_atom->comp_data->literal_table.length++;
+	cl_atom->comp_data->literal_table.atoms = gc_realloc(cl_atom->comp_data->literal_table.atoms, cl_atom->comp_data->literal_table.length * sizeof(atom_t*));
+	cl_atom->comp_data->literal_table.atoms[cl_atom->comp_data->literal_table.length - 1] = subject;
+	return cl_atom->comp_data->literal_table.length - 1;
 }
 
+/**
+ * Returns the index of `symbol` in the names of `cl` (args first, then locals) or -1 if it's not
+ * there. The names are searched from the end so the most recent binding (e.g. of an inner let
+ * block) shadows older ones. Names of let blocks that already ended are NULL.
+ */
 ssize_t bcc_symbol_in_names(atom_t *cl, atom_t *symbol){
 	assert(symbol->type == T_SYM);
-	for(size_t i = 0; i < cl->comp_data->arg_count + cl->comp_data->var_count; i++){
-		if ( strcmp(cl->comp_data->names[i], symbol->sym) == 0 )
+	for(ssize_t i = cl->comp_data->arg_count + cl->comp_data->var_count - 1; i >= 0; i--){
+		if ( cl->comp_data->names[i] != NULL && strcmp(cl->comp_data->names[i], symbol->sym) == 0 )
 			return i;
 	}
 	return -1;
+}
+
+/**
+ * Allocates the next free local slot and names it `name`. `name` can be NULL if the local should
+ * not be visible yet. The frame grows (var_count) only if no slot released by an ended let block
+ * is left. Returns the index of the local.
+ */
+size_t bcc_alloc_local(atom_t *cl, char *name){
+	compiler_data_t cd = cl->comp_data;
+	size_t idx = cd->local_count;
+	cd->local_count++;
+	if (cd->local_count > cd->var_count) {
+		cd->var_count = cd->local_count;
+		cd->names = gc_realloc(cd->names, (cd->arg_count + cd->var_count) * sizeof(cd->names[0]));
+	}
+	cd->names[cd->arg_count + idx] = name;
+	return idx;
+}
+
+/**
+ * Allocates a slot for a hidden temporary that is accessed with plain BC_LOAD_LOCAL and
+ * BC_STORE_LOCAL. Whether a local is boxed is decided per slot, so temporaries must never share
+ * a slot with a let binding: a captured binding would turn the stores of the temporary into
+ * stores into its box. Released temporary slots are therefore only reused by other temporaries
+ * and stay allocated for the rest of the lambda.
+ */
+size_t bcc_alloc_temp(atom_t *cl){
+	compiler_data_t cd = cl->comp_data;
+	if (cd->free_temp_count > 0)
+		return cd->free_temps[--cd->free_temp_count];
+	return bcc_alloc_local(cl, NULL);
+}
+
+void bcc_release_temp(atom_t *cl, size_t local_index){
+	compiler_data_t cd = cl->comp_data;
+	cd->free_temp_count++;
+	cd->free_temps = gc_realloc(cd->free_temps, cd->free_temp_count * sizeof(cd->free_temps[0]));
+	cd->free_temps[cd->free_temp_count-1] = local_index;
+}
+
+bool bcc_local_is_boxed(atom_t *cl, size_t local_index){
+	compiler_data_t cd = cl->comp_data;
+	for(size_t i = 0; i < cd->boxed_count; i++){
+		if (cd->boxed_locals[i] == local_index)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Returns the index of the captured variable `symbol` in the captures of `cl`. If `cl` doesn't
+ * capture the variable yet it's searched in the outer lambdas and added to the captures. The
+ * lambdas between `cl` and the lambda that defines the variable capture it, too. That way each
+ * runtime lambda can copy all its captured variables from the frame or runtime lambda it's
+ * created in (flat closures).
+ * 
+ * Locals are captured as boxes since they can be changed later on (e.g. by `set!` or a `define`
+ * after the lambda was created). Arguments are captured by value.
+ * 
+ * Returns -1 if no outer lambda defines the variable.
+ */
+ssize_t bcc_capture(atom_t *cl, atom_t *symbol){
+	assert(symbol->type == T_SYM);
+	compiler_data_t cd = cl->comp_data;
+	for(size_t i = 0; i < cd->capture_count; i++){
+		if ( strcmp(cd->captures[i].name, symbol->sym) == 0 )
+			return i;
+	}
+	
+	atom_t *parent = cd->parent;
+	if (parent == NULL)
+		return -1;
+	
+	capture_t capture;
+	ssize_t idx = bcc_symbol_in_names(parent, symbol);
+	if (idx != -1) {
+		if (idx < parent->comp_data->arg_count) {
+			capture = (capture_t){ .name = symbol->sym, .source = CAPTURE_ARG, .boxed = false, .index = idx };
+		} else {
+			idx = idx - parent->comp_data->arg_count;
+			capture = (capture_t){ .name = symbol->sym, .source = CAPTURE_LOCAL, .boxed = true, .index = idx };
+			
+			// Remember that the parent has to keep the local in a box
+			compiler_data_t pd = parent->comp_data;
+			if ( !bcc_local_is_boxed(parent, idx) ) {
+				pd->boxed_count++;
+				pd->boxed_locals = gc_realloc(pd->boxed_locals, pd->boxed_count * sizeof(pd->boxed_locals[0]));
+				pd->boxed_locals[pd->boxed_count-1] = idx;
+			}
+		}
+	} else {
+		idx = bcc_capture(parent, symbol);
+		if (idx == -1)
+			return -1;
+		capture = (capture_t){ .name = symbol->sym, .source = CAPTURE_CAPTURED, .boxed = parent->comp_data->captures[idx].boxed, .index = idx };
+	}
+	
+	cd->capture_count++;
+	cd->captures = gc_realloc(cd->captures, cd->capture_count * sizeof(cd->captures[0]));
+	cd->captures[cd->capture_count-1] = capture;
+	return cd->capture_count - 1;
+}
+
+/**
+ * Returns true if an instruction from `start` on accesses the local or a nested lambda captures
+ * it.
+ */
+static bool local_used(atom_t *cl, size_t local_index, size_t start){
+	compiler_data_t cd = cl->comp_data;
+	if ( bcc_local_is_boxed(cl, local_index) )
+		return true;
+	
+	for(size_t i = start; i < cd->bytecode.length; i++){
+		instruction_t *ins = &cd->bytecode.code[i];
+		if ( (ins->op == BC_LOAD_LOCAL || ins->op == BC_STORE_LOCAL) && ins->offset == 0 && ins->index == local_index )
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Changes all instructions that access locals captured by nested lambdas to their boxed versions.
+ * We only know which locals are captured after the entire lambda is compiled. A box for each of
+ * these locals is created at the start of the lambda. Nested lambdas might capture the box before
+ * the local is defined (e.g. recursive lambdas).
+ * 
+ * Boxing is decided per slot, so all bindings that ever use a boxed slot are boxed. That's fine
+ * for let bindings since their initial store creates a new box. Hidden temporaries are accessed
+ * unboxed and therefore get slots no binding ever uses (see bcc_alloc_temp()).
+ */
+static void box_captured_locals(atom_t *cl){
+	compiler_data_t cd = cl->comp_data;
+	if (cd->boxed_count == 0)
+		return;
+	
+	for(size_t i = 0; i < cd->bytecode.length; i++){
+		instruction_t *ins = &cd->bytecode.code[i];
+		if ( !(ins->op == BC_LOAD_LOCAL || ins->op == BC_STORE_LOCAL) || ins->offset != 0 )
+			continue;
+		if ( !bcc_local_is_boxed(cl, ins->index) )
+			continue;
+		
+		if (ins->op == BC_LOAD_LOCAL) {
+			ins->op = BC_LOAD_BOXED_LOCAL;
+		} else {
+			// let bindings get a new box each time they're executed (e.g. in a loop or when a slot is
+			// reused by another let block). Closures created for older bindings keep their box.
+			bool let_store = false;
+			for(size_t j = 0; j < cd->let_store_count; j++){
+				if (cd->let_stores[j] == i)
+					let_store = true;
+			}
+			ins->op = let_store ? BC_BOX_LOCAL : BC_STORE_BOXED_LOCAL;
+		}
+	}
+	
+	size_t prologue_length = cd->boxed_count + 2;
+	instruction_t prologue[prologue_length];
+	prologue[0] = (instruction_t){BC_LOAD_NIL};
+	for(size_t i = 0; i < cd->boxed_count; i++)
+		prologue[i+1] = (instruction_t){BC_BOX_LOCAL, .index = cd->boxed_locals[i]};
+	prologue[prologue_length-1] = (instruction_t){BC_DROP};
+	bcg_prepend(&cd->bytecode, prologue, prologue_length);
+}
+
+// Compiled lambdas with more instructions than this are not inlined
+#define INLINE_MAX_LENGTH 16
+
+/**
+ * Checks if the global runtime lambda `rl` can be inlined into a lambda compiled in `env`. Only
+ * small lambdas without locals, captured variables and nested lambdas are inlined. The only
+ * BC_RETURN has to be the last instruction. Lambdas that use the env (including the guards of
+ * calls inlined into them) are only inlined if they were defined in the same env.
+ */
+static bool inlinable(atom_t *rl, env_t *env){
+	if (rl->type != T_RUNTIME_LAMBDA || rl->scopes->type != SCOPE_ENV)
+		return false;
+	
+	compiler_data_t cd = rl->cl->comp_data;
+	if (cd->var_count != 0 || cd->capture_count != 0 || cd->max_frame_offset != 0 || cd->has_rest)
+		return false;
+	if (cd->bytecode.length == 0 || cd->bytecode.length > INLINE_MAX_LENGTH)
+		return false;
+	
+	for(size_t i = 0; i < cd->bytecode.length; i++){
+		instruction_t *ins = &cd->bytecode.code[i];
+		switch(ins->op){
+			case BC_RETURN:
+				if (i != cd->bytecode.length - 1)
+					return false;
+				break;
+			case BC_LOAD_ENV: case BC_STORE_ENV: case BC_GUARD_INLINED:
+				if (rl->scopes->env != env)
+					return false;
+				break;
+			case BC_LOAD_LOCAL: case BC_STORE_LOCAL: case BC_LOAD_LAMBDA:
+			case BC_LOAD_CAPTURED: case BC_LOAD_BOXED_CAPTURED: case BC_STORE_BOXED_CAPTURED:
+			case BC_LOAD_BOXED_LOCAL: case BC_STORE_BOXED_LOCAL: case BC_BOX_LOCAL:
+				return false;
+		}
+	}
+	
+	return cd->bytecode.code[cd->bytecode.length - 1].op == BC_RETURN;
+}
+
+/**
+ * Inlines a call of a small global compiled lambda (see inlinable()). The args are stored in
+ * temporaries (see bcc_alloc_temp()) and the bytecode of the lambda is copied with its BC_LOAD_ARG
+ * instructions changed to load these temporaries instead. The global binding might change later
+ * on (`define` or `set!`). Therefore a guard checks the version of that binding and does a normal
+ * call if it was changed. Other bindings don't affect the guard. We can't recompile the caller in
+ * that case since frames of running lambdas point into its bytecode.
+ * 
+ * Guards of calls that were inlined into the callee are copied along (with their literals), so
+ * the caller also notices when those bindings change.
+ * 
+ * Code generated for (f a b):
+ * 	a, STORE_LOCAL s0, DROP, b, STORE_LOCAL s1, DROP
+ * 	GUARD_INLINED binding version, jump to fallback
+ * 	inlined bytecode of f without BC_RETURN
+ * 	JUMP to end
+ * 	fallback: LOAD_ENV f, LOAD_LOCAL s0, LOAD_LOCAL s1, CALL 2
+ * 	end:
+ * 
+ * Returns false if the call can't be inlined. Nothing is generated in that case.
+ */
+static bool compile_inlined_call(atom_t *cl, atom_t *expr, env_t *env){
+	atom_t *function_slot = expr->first;
+	if (function_slot->type != T_SYM)
+		return false;
+	
+	// Arguments and locals of this or outer lambdas shadow the global binding
+	for(atom_t *current_cl = cl; current_cl != NULL; current_cl = current_cl->comp_data->parent){
+		if ( bcc_symbol_in_names(current_cl, function_slot) != -1 )
+			return false;
+	}
+	
+	// Only bindings of the env itself are inlined, the guard checks the version of that binding
+	ssize_t binding_index = env_binding_index(env, function_slot->sym);
+	if (binding_index == -1)
+		return false;
+	atom_t *rl = env->bindings[binding_index].value;
+	if ( !inlinable(rl, env) )
+		return false;
+	
+	compiler_data_t callee = rl->cl->comp_data;
+	size_t arg_count = 0;
+	for(atom_t *atom = expr->rest; atom->type == T_PAIR; atom = atom->rest)
+		arg_count++;
+	if (arg_count != callee->arg_count)
+		return false;
+	
+	// Evaluate the args into hidden temporaries
+	compiler_data_t cd = cl->comp_data;
+	size_t arg_locals[arg_count];
+	for(size_t i = 0; i < arg_count; i++)
+		arg_locals[i] = bcc_alloc_temp(cl);
+	
+	size_t i = 0;
+	for(atom_t *atom = expr->rest; atom->type == T_PAIR; atom = atom->rest, i++){
+		bcc_compile_expr(cl, atom->first, env);
+		bcg_gen(&cd->bytecode, (instruction_t){BC_STORE_LOCAL, .index = arg_locals[i], .offset = 0});
+		bcg_gen_op(&cd->bytecode, BC_DROP);
+	}
+	
+	uint64_t guard = ((uint64_t)binding_index << 32) | env->bindings[binding_index].version;
+	size_t guard_literal = bcc_add_atom_to_literal_table(cl, num_atom_alloc(guard));
+	size_t guard_index = bcg_gen(&cd->bytecode, (instruction_t){BC_GUARD_INLINED, .index = guard_literal, .offset = 0});
+	
+	for(size_t j = 0; j < callee->bytecode.length - 1; j++){
+		instruction_t ins = callee->bytecode.code[j];
+		switch(ins.op){
+			case BC_LOAD_ARG:
+				ins = (instruction_t){BC_LOAD_LOCAL, .index = arg_locals[ins.index], .offset = 0};
+				break;
+			case BC_LOAD_LITERAL: case BC_LOAD_ENV: case BC_STORE_ENV: case BC_GUARD_INLINED:
+				ins.index = bcc_add_atom_to_literal_table(cl, callee->literal_table.atoms[ins.index]);
+				break;
+		}
+		bcg_gen(&cd->bytecode, ins);
+	}
+	size_t end_jump_index = bcg_gen(&cd->bytecode, (instruction_t){BC_JUMP, .jump_offset = 0});
+	
+	// Fallback: normal call of whatever the global binding is now
+	cd->bytecode.code[guard_index].offset = cd->bytecode.length - guard_index - 1;
+	size_t literal_idx = bcc_add_atom_to_literal_table(cl, function_slot);
+	bcg_gen(&cd->bytecode, (instruction_t){BC_LOAD_ENV, .index = literal_idx, .offset = 0});
+	for(i = 0; i < arg_count; i++)
+		bcg_gen(&cd->bytecode, (instruction_t){BC_LOAD_LOCAL, .index = arg_locals[i], .offset = 0});
+	bcg_gen(&cd->bytecode, (instruction_t){BC_CALL, .num = arg_count});
+	bcg_backpatch_target_in(&cd->bytecode, end_jump_index);
+	
+	for(i = 0; i < arg_count; i++)
+		bcc_release_temp(cl, arg_locals[i]);
+	
+	return true;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef _BYTECODE_COMPILER_H
 #define _BYTECODE_COMPILER_H
 
+#include <stdbool.h>
 #include "memory.h"
 
 /*
@@ -17,7 +18,13 @@ Frame
 
 atom_t* bcc_compile_to_lambda(atom_t *arg_names, atom_t *body, env_t *env, atom_t *parent_cl);
 void bcc_compile_expr(atom_t *cl_atom, atom_t *expr, env_t *env);
+atom_t* bcc_fold_constant(atom_t *cl_atom, atom_t *expr, env_t *env);
 size_t bcc_add_atom_to_literal_table(atom_t *cl_atom, atom_t *subject);
 ssize_t bcc_symbol_in_names(atom_t *cl, atom_t *symbol);
+ssize_t bcc_capture(atom_t *cl, atom_t *symbol);
+size_t bcc_alloc_local(atom_t *cl, char *name);
+size_t bcc_alloc_temp(atom_t *cl);
+void bcc_release_temp(atom_t *cl, size_t local_index);
+bool bcc_local_is_boxed(atom_t *cl, size_t local_index);
 
 #endif
\ No newline at end of file
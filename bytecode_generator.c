@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <stdio.h>
 
@@ -74,6 +75,14 @@ size_t bcg_gen(bytecode_t *bc, instruction_t instruction){
 		printf("bc %p: BC_FIRST\n", bc);
 	else if (instruction.op == BC_REST)
 		printf("bc %p: BC_REST\n", bc);
+	else if (instruction.op == BC_VREF)
+		printf("bc %p: BC_VREF\n", bc);
+	else if (instruction.op == BC_VSET)
+		printf("bc %p: BC_VSET\n", bc);
+	else if (instruction.op == BC_LOAD_REST)
+		printf("bc %p: BC_LOAD_REST index %d\n", bc, instruction.index);
+	else if (instruction.op == BC_APPLY)
+		printf("bc %p: BC_APPLY num %d\n", bc, instruction.num);
 	
 	
 	return bc->length-1;
@@ -99,4 +108,35 @@ void bcg_backpatch_target_in(bytecode_t *bc, size_t index_of_jump_instruction){
 	size_t target_index = bc->length;
 	assert(bc->code[index_of_jump_instruction].op == BC_JUMP || bc->code[index_of_jump_instruction].op == BC_JUMP_IF_FALSE);
 	bc->code[index_of_jump_instruction].jump_offset = target_index - index_of_jump_instruction - 1;
+}
+
+/**
+ * Generates a jump instruction (`op` is BC_JUMP or BC_JUMP_IF_FALSE) that jumps to the already
+ * generated instruction at `target_index`. Used for backward jumps, e.g. of loops. The resulting
+ * jump offset is negative.
+ */
+size_t bcg_gen_jump_to(bytecode_t *bc, uint8_t op, size_t target_index){
+	assert(op == BC_JUMP || op == BC_JUMP_IF_FALSE);
+	assert(target_index <= bc->length);
+	return bcg_gen(bc, (instruction_t){op, .jump_offset = (ssize_t)target_index - (ssize_t)bc->length - 1});
+}
+
+/**
+ * Inserts `count` instructions at the start of the bytecode. Jump offsets are relative to the
+ * jump instruction so all jumps of the existing bytecode stay valid.
+ */
+void bcg_prepend(bytecode_t *bc, instruction_t *instructions, size_t count){
+	bc->code = gc_realloc(bc->code, (bc->length + count) * sizeof(bc->code[0]));
+	memmove(bc->code + count, bc->code, bc->length * sizeof(bc->code[0]));
+	memcpy(bc->code, instructions, count * sizeof(bc->code[0]));
+	bc->length += count;
+}
+
+/**
+ * Removes `count` instructions starting at `index`. No jump may cross the removed instructions.
+ */
+void bcg_remove(bytecode_t *bc, size_t index, size_t count){
+	assert(index + count <= bc->length);
+	memmove(bc->code + index, bc->code + index + count, (bc->length - index - count) * sizeof(bc->code[0]));
+	bc->length -= count;
 }
\ No newline at end of file
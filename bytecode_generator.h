@@ -10,5 +10,8 @@ void bcg_destroy(bytecode_t *bc);
 size_t bcg_gen(bytecode_t *bc, instruction_t instruction);
 size_t bcg_gen_op(bytecode_t *bc, uint8_t op);
 void bcg_backpatch_target_in(bytecode_t *bc, size_t index_of_jump_instruction);
+size_t bcg_gen_jump_to(bytecode_t *bc, uint8_t op, size_t target_index);
+void bcg_prepend(bytecode_t *bc, instruction_t *instructions, size_t count);
+void bcg_remove(bytecode_t *bc, size_t index, size_t count);
 
 #endif
\ No newline at end of file
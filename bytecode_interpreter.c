@@ -8,22 +8,32 @@
 #include "bytecode_interpreter.h"
 #include "logger.h"
 #include "eval.h"
+#include "bignum.h"
 
 
-void stack_reallocate_if_neccessary(stack_t *stack){
-	if ((*stack)->length > (*stack)->allocated){
-		(*stack)->allocated = (*stack)->length * 2;
-		*stack = gc_realloc(*stack, sizeof(size_t) * 2 + sizeof(atom_t) * (*stack)->allocated);
-		assert((*stack)->length <= (*stack)->allocated);
-	} else if ((*stack)->length < (*stack)->allocated / 3) {
-		(*stack)->allocated /= 2;
-		*stack = gc_realloc(*stack, sizeof(size_t) * 2 + sizeof(atom_t) * (*stack)->allocated);
-		assert((*stack)->length <= (*stack)->allocated);
-	}
+/**
+ * Grows the stack so at least `n` more atoms fit on it. The stack is never shrunk. A stack that
+ * grew once for a deep call chain is likely to grow again and shrinking on pop would reallocate
+ * it over and over again when the stack length oscillates around a threshold.
+ * 
+ * The stack might move in memory. Therefore the interpreter only stores stack indices.
+ */
+void stack_ensure(stack_t *stack, size_t n){
+	assert(stack != NULL && *stack != NULL);
+	if ((*stack)->length + n <= (*stack)->allocated)
+		return;
+	
+	size_t allocated = ((*stack)->allocated > 0) ? (*stack)->allocated * 2 : 64;
+	while((*stack)->length + n > allocated)
+		allocated *= 2;
+	
+	*stack = gc_realloc(*stack, sizeof(stack_s) + sizeof(atom_t*) * allocated);
+	assert(*stack != NULL);
+	(*stack)->allocated = allocated;
 }
 
 inline stack_t stack_new(size_t initial_allocated){
-	stack_t stack = gc_alloc(sizeof(size_t) * 2 + sizeof(atom_t) * initial_allocated);
+	stack_t stack = gc_alloc(sizeof(stack_s) + sizeof(atom_t*) * initial_allocated);
 	assert(stack != NULL);
 	stack->length = 0;
 	stack->allocated = initial_allocated;
@@ -36,30 +46,33 @@ inline void stack_destroy(stack_t *stack){
 	*stack = NULL;
 }
 	
+/**
+ * Pushing doesn't check the stack size. The space has to be reserved with stack_ensure() first.
+ * The interpreter does so once when it enters a frame (see max_stack_depth of the compiler data).
+ */
 inline void stack_push(stack_t *stack, atom_t *atom){
 	assert(stack != NULL && *stack != NULL);
 	assert(atom != NULL);
-	(*stack)->length++;
-	stack_reallocate_if_neccessary(stack);
-	(*stack)->atoms[(*stack)->length-1] = atom;
+	assert((*stack)->length < (*stack)->allocated);
+	(*stack)->atoms[(*stack)->length++] = atom;
 }
 
 inline void stack_push_n(stack_t *stack, atom_t *atom, size_t n){
 	assert(stack != NULL && *stack != NULL);
 	assert(atom != NULL);
-	(*stack)->length += n;
-	stack_reallocate_if_neccessary(stack);
+	assert((*stack)->length + n <= (*stack)->allocated);
 	for (size_t i = 0; i < n; i++)
-		(*stack)->atoms[(*stack)->length-1-i] = atom;
+		(*stack)->atoms[(*stack)->length++] = atom;
 }
 
+/**
+ * Popped slots are not cleared. They are overwritten by the next push and the conservative
+ * garbage collector might keep some dead atoms alive a bit longer. That's cheaper than a store
+ * on every pop.
+ */
 inline atom_t* stack_pop(stack_t *stack){
-	assert(stack != NULL && *stack != NULL);
-	atom_t *val = (*stack)->atoms[(*stack)->length-1];
-	(*stack)->atoms[(*stack)->length-1] = NULL;
-	(*stack)->length--;
-	stack_reallocate_if_neccessary(stack);
-	return val;
+	assert(stack != NULL && *stack != NULL && (*stack)->length > 0);
+	return (*stack)->atoms[--(*stack)->length];
 }
 
 inline atom_t* stack_peek(stack_t *stack){
@@ -68,11 +81,8 @@ inline atom_t* stack_peek(stack_t *stack){
 }
 
 inline void stack_pop_n(stack_t *stack, size_t n){
-	assert(stack != NULL && *stack != NULL);
-	for(size_t i = 0; i < n; i++)
-		(*stack)->atoms[(*stack)->length-1-i] = NULL;
+	assert(stack != NULL && *stack != NULL && (*stack)->length >= n);
 	(*stack)->length -= n;
-	stack_reallocate_if_neccessary(stack);
 }
 
 
@@ -88,6 +98,96 @@ void bci_destroy(bytecode_interpreter_t interpreter){
 	gc_free(interpreter);
 }
 
+// The interpreter of the current thread, see bci_current()
+static __thread bytecode_interpreter_t current_interpreter = NULL;
+
+/**
+ * Returns the interpreter of the current thread. It's created on first use and used for all
+ * compiled lambdas called from the AST interpreter or buildins. bci_eval() is reentrant: nested
+ * calls just build their frames on top of the frames already on the stack.
+ * 
+ * The interpreter and its stack are allocated uncollectable since the garbage collector doesn't
+ * scan thread local storage. The stack is still scanned for atoms.
+ */
+bytecode_interpreter_t bci_current(){
+	if (current_interpreter == NULL) {
+		size_t preallocated_stack_size = 1024;
+		bytecode_interpreter_t interpreter = gc_alloc_uncollectable(sizeof(bytecode_interpreter_s));
+		interpreter->stack = gc_alloc_uncollectable(sizeof(stack_s) + sizeof(atom_t*) * preallocated_stack_size);
+		interpreter->stack->length = 0;
+		interpreter->stack->allocated = preallocated_stack_size;
+		current_interpreter = interpreter;
+	}
+	return current_interpreter;
+}
+
+/**
+ * Makes `interpreter` the one bci_current() returns on this thread and returns the previous
+ * one. With NULL the next bci_current() creates a new interpreter. The caller has to keep the
+ * interpreter reachable for the garbage collector, e.g. in a context (see context.h).
+ */
+bytecode_interpreter_t bci_set_current(bytecode_interpreter_t interpreter){
+	bytecode_interpreter_t previous = current_interpreter;
+	current_interpreter = interpreter;
+	return previous;
+}
+
+/**
+ * Returns a pointer to the frame `offset` scopes up the scope chain (0 is the current frame).
+ * Outer frames are looked up in the display of the scope chain of the runtime lambda `rl`. So
+ * the access takes constant time no matter how deep the lambdas are nested.
+ */
+static inline atom_t** frame_at_offset(bytecode_interpreter_t interp, atom_t *rl, size_t frame_index, size_t arg_count, uint16_t offset, size_t *frame_arg_count){
+	if (offset == 0) {
+		*frame_arg_count = arg_count;
+		return interp->stack->atoms + frame_index;
+	}
+	
+	assert(offset - 1 < rl->scopes->depth);
+	scope_p target_scope = rl->scopes->display[offset - 1];
+	assert(target_scope->type != SCOPE_ENV);
+	*frame_arg_count = target_scope->arg_count;
+	if (target_scope->type == SCOPE_STACK)
+		return interp->stack->atoms + target_scope->frame_index;
+	else
+		return target_scope->atoms;
+}
+
+static atom_t* bci_run(bytecode_interpreter_t interp, atom_t* rl, size_t arg_count, env_t *env);
+
+/**
+ * Calls the runtime lambda `rl` with the arguments in the list `args`.
+ */
+atom_t* bci_eval(bytecode_interpreter_t interp, atom_t* rl, atom_t *args, env_t *env){
+	assert(rl->type == T_RUNTIME_LAMBDA);
+	size_t args_length = 0;
+	for(atom_t *atom = args; atom->type == T_PAIR; atom = atom->rest)
+		args_length++;
+	stack_ensure(&interp->stack, 1 + args_length + rl->cl->comp_data->var_count + 1 + rl->cl->comp_data->max_stack_depth);
+	
+	stack_push(&interp->stack, rl);
+	for(atom_t *atom = args; atom->type == T_PAIR; atom = atom->rest)
+		stack_push(&interp->stack, atom->first);
+	
+	return bci_run(interp, rl, args_length, env);
+}
+
+/**
+ * Calls the runtime lambda `rl` with `arg_count` arguments from the `args` array. The arguments
+ * are pushed onto the stack directly without building an argument list first. Meant for buildins
+ * that call a lambda for many values (e.g. map).
+ */
+atom_t* bci_call(bytecode_interpreter_t interp, atom_t* rl, atom_t **args, size_t arg_count, env_t *env){
+	assert(rl->type == T_RUNTIME_LAMBDA);
+	stack_ensure(&interp->stack, 1 + arg_count + rl->cl->comp_data->var_count + 1 + rl->cl->comp_data->max_stack_depth);
+	
+	stack_push(&interp->stack, rl);
+	for(size_t i = 0; i < arg_count; i++)
+		stack_push(&interp->stack, args[i]);
+	
+	return bci_run(interp, rl, arg_count, env);
+}
+
 /**
  * Abbreviations: fp = frame pointer, ip = instruction pointer
  * 
@@ -101,57 +201,27 @@ void bci_destroy(bytecode_interpreter_t interpreter){
  * of the previously executed compiled lambda. This allows the stack and previous lambda
  * to be moved in memory. Important for the stack since it can grow (and be reallocated
  * while dooing so). The compiled lambda atom might move due to a future garbage collector.
+ * 
+ * The caller already pushed `rl` and its arguments and reserved the stack space for the frame.
  */
-atom_t* bci_eval(bytecode_interpreter_t interp, atom_t* rl, atom_t *args, env_t *env){
+static atom_t* bci_run(bytecode_interpreter_t interp, atom_t* rl, size_t arg_count, env_t *env){
 	// The variables used by the interpreter to refer to the current context
-	size_t frame_index, arg_count;
+	size_t frame_index = interp->stack->length - 1 - arg_count;
 	instruction_t *ip;
-	scope_p frame_scope = NULL;  // allocated when the first lambda is built
-	uint8_t scope_escaped = false;
-	
-	// Build the initial stack frame and context variables
-	assert(rl->type == T_RUNTIME_LAMBDA);
-	frame_index = interp->stack->length;
-	stack_push(&interp->stack, rl);
-	
-	arg_count = 0;
-	for(atom_t *atom = args; atom->type == T_PAIR; atom = atom->rest){
-		stack_push(&interp->stack, atom->first);
-		arg_count++;
-	}
+	scope_p frame_scope = NULL;  // allocated when the first lambda that needs this frame is built
 	
-	if (arg_count != rl->cl->comp_data->arg_count){
-		warn("Not enough arguments for function! Got %d, required %d", arg_count, rl->cl->comp_data->arg_count);
+	compiler_data_t cd = rl->cl->comp_data;
+	if ( arg_count < cd->arg_count || (arg_count > cd->arg_count && !cd->has_rest) ){
+		warn("Wrong number of arguments for function! Got %d, required %d", arg_count, cd->arg_count);
+		// Remove the half build frame, the stack might be shared with the frames of outer calls
+		stack_pop_n(&interp->stack, 1 + arg_count);
 		return nil_atom();
 	}
 	
 	stack_push_n(&interp->stack, nil_atom(), rl->cl->comp_data->var_count);
 	stack_push(&interp->stack, nil_atom());
-	ip = rl->cl->bytecode.code;
-	
+	ip = rl->cl->comp_data->bytecode.code;
 	
-	inline void check_atom_for_escaped_scope(atom_t *subject){
-		if (frame_scope == NULL || scope_escaped == true)
-			return;
-		
-		switch(subject->type){
-			case T_PAIR:
-				check_atom_for_escaped_scope(subject->first);
-				check_atom_for_escaped_scope(subject->rest);
-				break;
-			case T_RUNTIME_LAMBDA:
-				for (scope_p s = subject->scopes; s != NULL; s = s->next){
-					if (s == frame_scope){
-						scope_escaped = true;
-						return;
-					}
-				}
-				break;
-			default:
-				// Other atoms don't need to be checked (can't contain scope references)
-				break;
-		}
-	}
 	
 	while(true){
 		switch(ip->op){
@@ -168,78 +238,123 @@ atom_t* bci_eval(bytecode_interpreter_t interp, atom_t* rl, atom_t *args, env_t
 				stack_push(&interp->stack, num_atom_alloc(ip->num));
 				break;
 			case BC_LOAD_LITERAL: case BC_LOAD_LAMBDA: {
-				scope_t this_scope = (scope_t){ .next = rl->scopes, .type = SCOPE_STACK, .arg_count = arg_count, .frame_index = frame_index};
-				scope_p target_scope = &this_scope;
-				for(uint16_t scope_offset = ip->offset; scope_offset > 0; scope_offset--)
-					target_scope = target_scope->next;
-				
-				assert(target_scope->type != SCOPE_ENV);
-				atom_t **frame_pointer = NULL;
-				if (target_scope->type == SCOPE_STACK)
-					frame_pointer = interp->stack->atoms + target_scope->frame_index;
-				else
-					frame_pointer = target_scope->atoms;
+				size_t frame_arg_count;
+				atom_t **frame_pointer = frame_at_offset(interp, rl, frame_index, arg_count, ip->offset, &frame_arg_count);
 				
 				assert(frame_pointer[0]->type == T_RUNTIME_LAMBDA);
 				atom_t *target_cl = frame_pointer[0]->cl;
-				assert(ip->index < target_cl->literal_table.length);
+				assert(ip->index < target_cl->comp_data->literal_table.length);
 				if (ip->op == BC_LOAD_LITERAL) {
-					assert(target_cl->literal_table.atoms[ip->index]->type != T_COMPILED_LAMBDA);
-					stack_push(&interp->stack, target_cl->literal_table.atoms[ip->index]);
+					assert(target_cl->comp_data->literal_table.atoms[ip->index]->type != T_COMPILED_LAMBDA);
+					stack_push(&interp->stack, target_cl->comp_data->literal_table.atoms[ip->index]);
 				} else {
-					atom_t *compiled_lambda = target_cl->literal_table.atoms[ip->index];
+					atom_t *compiled_lambda = target_cl->comp_data->literal_table.atoms[ip->index];
 					assert(compiled_lambda->type == T_COMPILED_LAMBDA);
-					if (frame_scope == NULL)
-						frame_scope = scope_stack_alloc(rl->scopes, arg_count, frame_index);
-					atom_t *new_rl = runtime_lambda_atom_alloc(compiled_lambda, frame_scope);
+					atom_t *new_rl = NULL;
+					if (compiled_lambda->comp_data->max_frame_offset > 0) {
+						// The lambda accesses our frame (or frames further out), so it has to capture it
+						if (frame_scope == NULL)
+							frame_scope = scope_stack_alloc(rl->scopes, arg_count, frame_index);
+						new_rl = runtime_lambda_atom_alloc(compiled_lambda, frame_scope);
+					} else {
+						// The compiler saw that the lambda never uses our frame, only the definition env at
+						// the end of our scope chain. Share our chain and the frame can't escape through it.
+						new_rl = runtime_lambda_atom_alloc(compiled_lambda, rl->scopes);
+					}
+					
+					// Copy the captured variables into the new lambda (flat closure)
+					compiler_data_t cd = compiled_lambda->comp_data;
+					if (cd->capture_count > 0) {
+						atom_t **frame = interp->stack->atoms + frame_index;
+						new_rl->captured = gc_alloc(cd->capture_count * sizeof(atom_t*));
+						for(size_t i = 0; i < cd->capture_count; i++){
+							capture_t *capture = &cd->captures[i];
+							switch(capture->source){
+								case CAPTURE_ARG:
+									assert(capture->index < arg_count);
+									new_rl->captured[i] = frame[1 + capture->index];
+									break;
+								case CAPTURE_LOCAL:
+									assert(frame[1 + arg_count + capture->index]->type == T_BOX);
+									new_rl->captured[i] = frame[1 + arg_count + capture->index];
+									break;
+								case CAPTURE_CAPTURED:
+									assert(capture->index < rl->cl->comp_data->capture_count);
+									new_rl->captured[i] = rl->captured[capture->index];
+									break;
+							}
+						}
+					}
+					
 					stack_push(&interp->stack, new_rl);
 				}
 				} break;
 				
 			case BC_LOAD_ARG: case BC_LOAD_LOCAL: case BC_STORE_LOCAL: {
-				scope_t this_scope = (scope_t){ .next = rl->scopes, .type = SCOPE_STACK, .arg_count = arg_count, .frame_index = frame_index};
-				scope_p target_scope = &this_scope;
-				for(uint16_t scope_offset = ip->offset; scope_offset > 0; scope_offset--)
-					target_scope = target_scope->next;
-				
-				assert(target_scope->type != SCOPE_ENV);
-				atom_t **frame_pointer = NULL;
-				if (target_scope->type == SCOPE_STACK)
-					frame_pointer = interp->stack->atoms + target_scope->frame_index;
-				else
-					frame_pointer = target_scope->atoms;
+				size_t frame_arg_count;
+				atom_t **frame_pointer = frame_at_offset(interp, rl, frame_index, arg_count, ip->offset, &frame_arg_count);
 				
 				switch(ip->op){
 				case BC_LOAD_ARG:
-					assert(ip->index < target_scope->arg_count);
+					assert(ip->index < frame_arg_count);
 					stack_push(&interp->stack, frame_pointer[ip->index+1]);
 					break;
 				case BC_LOAD_LOCAL:
 					assert(frame_pointer[0]->type == T_RUNTIME_LAMBDA && ip->index < frame_pointer[0]->cl->comp_data->var_count);
-					stack_push(&interp->stack, frame_pointer[target_scope->arg_count + ip->index+1]);
+					stack_push(&interp->stack, frame_pointer[frame_arg_count + ip->index+1]);
 					break;
 				case BC_STORE_LOCAL: {
 					assert(frame_pointer[0]->type == T_RUNTIME_LAMBDA && ip->index < frame_pointer[0]->cl->comp_data->var_count);
 					atom_t *value = stack_peek(&interp->stack);
-					if (ip->offset > 0)  // no need to check if we store the atom in our own stack frame
-						check_atom_for_escaped_scope(value);
-					frame_pointer[target_scope->arg_count + ip->index+1] = value;
+					frame_pointer[frame_arg_count + ip->index+1] = value;
 					}break;
 				}
 				
 				} break;
 				
+			case BC_LOAD_REST: {
+				atom_t *list = nil_atom();
+				for(size_t i = arg_count; i > ip->index; i--)
+					list = pair_atom_alloc(interp->stack->atoms[frame_index + i], list);
+				stack_push(&interp->stack, list);
+				} break;
+				
+			case BC_LOAD_CAPTURED:
+				assert(ip->index < rl->cl->comp_data->capture_count);
+				stack_push(&interp->stack, rl->captured[ip->index]);
+				break;
+			case BC_LOAD_BOXED_CAPTURED:
+				assert(ip->index < rl->cl->comp_data->capture_count && rl->captured[ip->index]->type == T_BOX);
+				stack_push(&interp->stack, rl->captured[ip->index]->boxed);
+				break;
+			case BC_STORE_BOXED_CAPTURED:
+				assert(ip->index < rl->cl->comp_data->capture_count && rl->captured[ip->index]->type == T_BOX);
+				rl->captured[ip->index]->boxed = stack_peek(&interp->stack);
+				break;
+				
+			case BC_LOAD_BOXED_LOCAL: case BC_STORE_BOXED_LOCAL: case BC_BOX_LOCAL: {
+				assert(ip->index < rl->cl->comp_data->var_count);
+				atom_t **local = interp->stack->atoms + frame_index + 1 + arg_count + ip->index;
+				if (ip->op == BC_BOX_LOCAL) {
+					*local = box_atom_alloc(stack_peek(&interp->stack));
+				} else {
+					assert((*local)->type == T_BOX);
+					if (ip->op == BC_LOAD_BOXED_LOCAL)
+						stack_push(&interp->stack, (*local)->boxed);
+					else
+						(*local)->boxed = stack_peek(&interp->stack);
+				}
+				} break;
+				
 			case BC_LOAD_ENV: case BC_STORE_ENV: {
-				// First loop though the scope chain to get the definition env
-				scope_p target_scope = rl->scopes;
-				while(target_scope->next != NULL)
-					target_scope = target_scope->next;
+				// The definition env is the last entry in the display of our scope chain
+				scope_p target_scope = rl->scopes->display[rl->scopes->depth];
 				assert(target_scope->type == SCOPE_ENV);
 				env_t *target_env = target_scope->env;
 				
 				// Pop the key symbol
-				assert(ip->index < rl->cl->literal_table.length);
-				atom_t *key = rl->cl->literal_table.atoms[ip->index];
+				assert(ip->index < rl->cl->comp_data->literal_table.length);
+				atom_t *key = rl->cl->comp_data->literal_table.atoms[ip->index];
 				assert(key->type == T_SYM);
 				
 				if (ip->op == BC_LOAD_ENV) {
@@ -252,7 +367,6 @@ atom_t* bci_eval(bytecode_interpreter_t interp, atom_t* rl, atom_t *args, env_t
 					}
 				} else {
 					atom_t *value = stack_peek(&interp->stack);
-					check_atom_for_escaped_scope(value);
 					env_set(target_env, key->sym, value);
 				}
 				} break;
@@ -263,29 +377,61 @@ atom_t* bci_eval(bytecode_interpreter_t interp, atom_t* rl, atom_t *args, env_t
 			case BC_JUMP:
 				ip += ip->jump_offset;
 				break;
+			case BC_GUARD_INLINED: {
+				// Same env as BC_LOAD_ENV uses, the literal has the binding index in the upper and the
+				// version in the lower 32 bits
+				env_t *target_env = rl->scopes->display[rl->scopes->depth]->env;
+				int64_t guard = rl->cl->comp_data->literal_table.atoms[ip->index]->num;
+				size_t binding_index = (uint64_t)guard >> 32;
+				uint32_t version = guard & 0xffffffff;
+				if ( binding_index >= target_env->length || target_env->bindings[binding_index].version != version )
+					ip += ip->offset;
+				} break;
 			case BC_JUMP_IF_FALSE:
 				if (stack_pop(&interp->stack) == false_atom())
 					ip += ip->jump_offset;
 				break;
 				
 				
-			case BC_CALL: {
-					uint16_t call_arg_count = ip->num;
+			case BC_CALL: case BC_APPLY: {
+					size_t call_arg_count = ip->num;
+					if (ip->op == BC_APPLY) {
+						// Replace the list with its elements
+						atom_t *list = stack_pop(&interp->stack);
+						call_arg_count--;
+						size_t list_length = 0;
+						for(atom_t *pair = list; pair->type == T_PAIR; pair = pair->rest)
+							list_length++;
+						stack_ensure(&interp->stack, list_length);
+						for(atom_t *pair = list; pair->type == T_PAIR; pair = pair->rest)
+							stack_push(&interp->stack, pair->first);
+						call_arg_count += list_length;
+					}
+					
 					atom_t *func = interp->stack->atoms[interp->stack->length - 1 - call_arg_count]; // length - 1 => last arg, - call_arg_count => func
 					
 					switch (func->type) {
 						case T_RUNTIME_LAMBDA: {
+							// Same check as in bci_run(), a rest parameter still needs all the fixed args
+							compiler_data_t func_cd = func->cl->comp_data;
+							if ( call_arg_count < func_cd->arg_count || (call_arg_count > func_cd->arg_count && !func_cd->has_rest) ){
+								warn("Wrong number of arguments for function! Got %zu, required %zu", call_arg_count, func_cd->arg_count);
+								stack_pop_n(&interp->stack, 1 + call_arg_count);
+								stack_push(&interp->stack, nil_atom());
+								break;
+							}
+							
 							// Continue to use the stack
-							atom_t *saved_state = interpreter_state_atom_alloc(frame_index, ip - rl->cl->bytecode.code, arg_count, scope_escaped, frame_scope);
+							atom_t *saved_state = interpreter_state_atom_alloc(frame_index, ip - rl->cl->comp_data->bytecode.code, arg_count, frame_scope);
 							
 							arg_count = call_arg_count;
-							// TODO: check if argument count on stack match the required argument count of the compiled lambda
 							frame_index = interp->stack->length - 1 - call_arg_count; // length - 1 => last arg, - call_arg_count => func
 							rl = func;
-							ip = rl->cl->bytecode.code;
+							ip = rl->cl->comp_data->bytecode.code;
 							frame_scope = NULL;
-							scope_escaped = false;
 							
+							// Reserve the stack space for the entire frame, the instructions don't check it
+							stack_ensure(&interp->stack, rl->cl->comp_data->var_count + 1 + rl->cl->comp_data->max_stack_depth);
 							stack_push_n(&interp->stack, nil_atom(), rl->cl->comp_data->var_count);
 							stack_push(&interp->stack, saved_state);
 							
@@ -295,10 +441,10 @@ atom_t* bci_eval(bytecode_interpreter_t interp, atom_t* rl, atom_t *args, env_t
 							} break;
 							
 						case T_BUILDIN: {
-							// Build a pair argument list of the args and pop them from the stack while we're at it
-							atom_t *arg_atoms = nil_atom();
-							for(size_t i = 0; i < call_arg_count; i++)
-								arg_atoms = pair_atom_alloc(stack_pop(&interp->stack), arg_atoms);
+							// Build a pair argument list of the args on the stack and pop them
+							size_t args_index = interp->stack->length - call_arg_count;
+							atom_t *arg_atoms = eval_buildin_args(&interp->stack->atoms[args_index], call_arg_count);
+							interp->stack->length = args_index;
 							
 							// Pop the func from the stack
 							atom_t *popped_func = stack_pop(&interp->stack);
@@ -310,6 +456,12 @@ atom_t* bci_eval(bytecode_interpreter_t interp, atom_t* rl, atom_t *args, env_t
 							} break;
 							
 						case T_LAMBDA: {
+							if ( !eval_check_rest_args(func, call_arg_count) ) {
+								stack_pop_n(&interp->stack, 1 + call_arg_count);
+								stack_push(&interp->stack, nil_atom());
+								break;
+							}
+							
 							// Create a new env with the unevaled args in it (the args on the stack have already been evaled by the compiled bytecode)
 							env_t *lambda_env = env_alloc(func->env);
 							
@@ -325,6 +477,9 @@ atom_t* bci_eval(bytecode_interpreter_t interp, atom_t* rl, atom_t *args, env_t
 								arg_name_pair = arg_name_pair->rest;
 								arg_value_pair = arg_value_pair->rest;
 							}
+							// A rest parameter gets the list of the remaining args
+							if (arg_name_pair->type == T_SYM)
+								env_def(lambda_env, arg_name_pair->sym, arg_value_pair);
 							
 							// Pop the func from the stack
 							atom_t *popped_func = stack_pop(&interp->stack);
@@ -347,10 +502,10 @@ atom_t* bci_eval(bytecode_interpreter_t interp, atom_t* rl, atom_t *args, env_t
 					// TODO: Make sure to revert to the start frame_index here. Right now we're done for if a function does
 					// not pop as many values as it pushes (in all brances).
 					atom_t *state = stack_pop(&interp->stack);
-					// Search the return value for an escaped scope if necessary
-					check_atom_for_escaped_scope(return_value);
-					// Capture the scope if it escaped
-					if (scope_escaped){
+					// frame_scope is only allocated when we created a lambda that needs our frame (the compiler
+					// knows which ones do). That lambda might still be alive after we return, so capture
+					// the frame. This is cheaper than searching the return value and stored values for it.
+					if (frame_scope != NULL){
 						size_t frame_size = (1 + arg_count + rl->cl->comp_data->var_count) * sizeof(atom_t*);
 						frame_scope->type = SCOPE_HEAP;
 						// The GC will free the frame when it's no longer needed
@@ -364,9 +519,8 @@ atom_t* bci_eval(bytecode_interpreter_t interp, atom_t* rl, atom_t *args, env_t
 						arg_count = state->interpreter_state.arg_count;
 						frame_index = state->interpreter_state.fp_index;
 						rl = interp->stack->atoms[frame_index];
-						ip = rl->cl->bytecode.code + state->interpreter_state.ip_index;
+						ip = rl->cl->comp_data->bytecode.code + state->interpreter_state.ip_index;
 						frame_scope = state->interpreter_state.frame_scope;
-						scope_escaped = state->interpreter_state.scope_escaped;
 						stack_push(&interp->stack, return_value);
 					} else {
 						return return_value;
@@ -377,36 +531,60 @@ atom_t* bci_eval(bytecode_interpreter_t interp, atom_t* rl, atom_t *args, env_t
 			case BC_ADD: {
 				atom_t *b = stack_pop(&interp->stack);
 				atom_t *a = stack_pop(&interp->stack);
-				assert(a->type == T_NUM && b->type == T_NUM);
-				stack_push(&interp->stack, num_atom_alloc(a->num + b->num));
+				int64_t result;
+				// Stay with int64_t as long as the result fits, switch to bignums on overflow
+				if ( a->type == T_NUM && b->type == T_NUM && !__builtin_add_overflow(a->num, b->num, &result) )
+					stack_push(&interp->stack, num_atom_alloc(result));
+				else if (a->type == T_FLOAT && b->type == T_FLOAT)
+					stack_push(&interp->stack, float_atom_alloc(a->real + b->real));
+				else
+					stack_push(&interp->stack, num_add(a, b));
 			} break;
 			
 			case BC_SUB: {
 				atom_t *b = stack_pop(&interp->stack);
 				atom_t *a = stack_pop(&interp->stack);
-				assert(a->type == T_NUM && b->type == T_NUM);
-				stack_push(&interp->stack, num_atom_alloc(a->num - b->num));
+				int64_t result;
+				if ( a->type == T_NUM && b->type == T_NUM && !__builtin_sub_overflow(a->num, b->num, &result) )
+					stack_push(&interp->stack, num_atom_alloc(result));
+				else if (a->type == T_FLOAT && b->type == T_FLOAT)
+					stack_push(&interp->stack, float_atom_alloc(a->real - b->real));
+				else
+					stack_push(&interp->stack, num_sub(a, b));
 			} break;
 			
 			case BC_MUL: {
 				atom_t *b = stack_pop(&interp->stack);
 				atom_t *a = stack_pop(&interp->stack);
-				assert(a->type == T_NUM && b->type == T_NUM);
-				stack_push(&interp->stack, num_atom_alloc(a->num * b->num));
+				int64_t result;
+				if ( a->type == T_NUM && b->type == T_NUM && !__builtin_mul_overflow(a->num, b->num, &result) )
+					stack_push(&interp->stack, num_atom_alloc(result));
+				else if (a->type == T_FLOAT && b->type == T_FLOAT)
+					stack_push(&interp->stack, float_atom_alloc(a->real * b->real));
+				else
+					stack_push(&interp->stack, num_mul(a, b));
 			} break;
 			
 			case BC_DIV: {
 				atom_t *b = stack_pop(&interp->stack);
 				atom_t *a = stack_pop(&interp->stack);
-				assert(a->type == T_NUM && b->type == T_NUM);
-				stack_push(&interp->stack, num_atom_alloc(a->num / b->num));
+				if (b->type == T_NUM && b->num == 0) {
+					warn("BC_DIV: division by zero");
+					stack_push(&interp->stack, nil_atom());
+				} else {
+					stack_push(&interp->stack, num_div(a, b));
+				}
 			} break;
 			
 			case BC_MOD: {
 				atom_t *b = stack_pop(&interp->stack);
 				atom_t *a = stack_pop(&interp->stack);
-				assert(a->type == T_NUM && b->type == T_NUM);
-				stack_push(&interp->stack, num_atom_alloc(a->num % b->num));
+				if (b->type == T_NUM && b->num == 0) {
+					warn("BC_MOD: modulo by zero");
+					stack_push(&interp->stack, nil_atom());
+				} else {
+					stack_push(&interp->stack, num_mod(a, b));
+				}
 			} break;
 			
 			case BC_EQ: {
@@ -414,16 +592,14 @@ atom_t* bci_eval(bytecode_interpreter_t interp, atom_t* rl, atom_t *args, env_t
 				atom_t *a = stack_pop(&interp->stack);
 				atom_t *result = false_atom();
 				
-				if (a->type == b->type) {
-					switch(a->type){
-						case T_NUM:
-							if (a->num == b->num)
-								result = true_atom();
-							break;
-						default:
-							assert(0);
-							break;
-					}
+				if (a->type == T_NUM && b->type == T_NUM) {
+					if (a->num == b->num)
+						result = true_atom();
+				} else if ( is_num_atom(a) && is_num_atom(b) ) {
+					if (num_cmp(a, b) == 0)
+						result = true_atom();
+				} else if (a->type == b->type) {
+					assert(0);
 				}
 				
 				stack_push(&interp->stack, result);
@@ -433,16 +609,14 @@ atom_t* bci_eval(bytecode_interpreter_t interp, atom_t* rl, atom_t *args, env_t
 				atom_t *a = stack_pop(&interp->stack);
 				atom_t *result = false_atom();
 				
-				if (a->type == b->type) {
-					switch(a->type){
-						case T_NUM:
-							if (a->num < b->num)
-								result = true_atom();
-							break;
-						default:
-							assert(0);
-							break;
-					}
+				if (a->type == T_NUM && b->type == T_NUM) {
+					if (a->num < b->num)
+						result = true_atom();
+				} else if ( is_num_atom(a) && is_num_atom(b) ) {
+					if (num_cmp(a, b) == -1)
+						result = true_atom();
+				} else if (a->type == b->type) {
+					assert(0);
 				}
 				
 				stack_push(&interp->stack, result);
@@ -452,16 +626,14 @@ atom_t* bci_eval(bytecode_interpreter_t interp, atom_t* rl, atom_t *args, env_t
 				atom_t *a = stack_pop(&interp->stack);
 				atom_t *result = false_atom();
 				
-				if (a->type == b->type) {
-					switch(a->type){
-						case T_NUM:
-							if (a->num > b->num)
-								result = true_atom();
-							break;
-						default:
-							assert(0);
-							break;
-					}
+				if (a->type == T_NUM && b->type == T_NUM) {
+					if (a->num > b->num)
+						result = true_atom();
+				} else if ( is_num_atom(a) && is_num_atom(b) ) {
+					if (num_cmp(a, b) == 1)
+						result = true_atom();
+				} else if (a->type == b->type) {
+					assert(0);
 				}
 				
 				stack_push(&interp->stack, result);
@@ -483,12 +655,37 @@ atom_t* bci_eval(bytecode_interpreter_t interp, atom_t* rl, atom_t *args, env_t
 				stack_push(&interp->stack, pair->rest);
 			} break;
 			
+			case BC_VREF: {
+				atom_t *index = stack_pop(&interp->stack);
+				atom_t *vector = stack_pop(&interp->stack);
+				assert(vector->type == T_VECTOR && index->type == T_NUM);
+				if (index->num < 0 || (size_t)index->num >= vector->length) {
+					warn("BC_VREF: index %ld out of range", index->num);
+					stack_push(&interp->stack, nil_atom());
+				} else {
+					stack_push(&interp->stack, vector->elements[index->num]);
+				}
+			} break;
+			case BC_VSET: {
+				atom_t *value = stack_pop(&interp->stack);
+				atom_t *index = stack_pop(&interp->stack);
+				atom_t *vector = stack_pop(&interp->stack);
+				assert(vector->type == T_VECTOR && index->type == T_NUM);
+				if (index->num < 0 || (size_t)index->num >= vector->length) {
+					warn("BC_VSET: index %ld out of range", index->num);
+					stack_push(&interp->stack, nil_atom());
+				} else {
+					vector->elements[index->num] = value;
+					stack_push(&interp->stack, value);
+				}
+			} break;
+			
 			default:
 				// Unknown bytecode instruction
 				assert(false);
 		}
 		ip++;
-		assert(ip < rl->cl->bytecode.code + rl->cl->bytecode.length);
+		assert(ip < rl->cl->comp_data->bytecode.code + rl->cl->comp_data->bytecode.length);
 	}
 	
 	return nil_atom();
@@ -11,6 +11,7 @@ typedef struct {
 
 stack_t stack_new(size_t initial_allocated);
 void stack_destroy(stack_t *stack);
+void stack_ensure(stack_t *stack, size_t n);
 void stack_push(stack_t *stack, atom_t *atom);
 atom_t* stack_pop(stack_t *stack);
 
@@ -20,7 +21,10 @@ typedef struct {
 
 bytecode_interpreter_t bci_new(size_t preallocated_stack_size);
 void bci_destroy(bytecode_interpreter_t interpreter);
+bytecode_interpreter_t bci_current();
+bytecode_interpreter_t bci_set_current(bytecode_interpreter_t interpreter);
 
 atom_t* bci_eval(bytecode_interpreter_t interpreter, atom_t* compiled_lambda, atom_t *args, env_t *env);
+atom_t* bci_call(bytecode_interpreter_t interpreter, atom_t* compiled_lambda, atom_t **args, size_t arg_count, env_t *env);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include <stdio.h>
+
+#include "context.h"
+#include "logger.h"
+#include "scanner.h"
+#include "reader.h"
+#include "eval.h"
+#include "buildins.h"
+
+// The context the current thread entered, see context_enter()
+static __thread lisp_context_t *current_context = NULL;
+// Set if context_enter() registered the thread with the collector
+static __thread bool registered_thread = false;
+
+
+/**
+ * Creates a new context with its own global environment and interpreter. The context is
+ * allocated uncollectable since it's referenced from thread local storage. Free it with
+ * context_destroy().
+ */
+lisp_context_t* context_new(bool compile_lambdas){
+	lisp_context_t *context = gc_alloc_uncollectable(sizeof(lisp_context_t));
+	context->env = env_alloc(NULL);
+	context->interpreter = bci_new(1024);
+	context->log_level = 0;
+	context->log_os = NULL;
+	context->entered_count = 0;
+	
+	register_buildins_in(context->env);
+	env_def(context->env, "__compile_lambdas", compile_lambdas ? true_atom() : false_atom());
+	
+	return context;
+}
+
+/**
+ * Frees the interpreter of `context`. Returns false without destroying anything if the context is
+ * still entered, by the calling thread (leave it first) or by any other thread.
+ */
+bool context_destroy(lisp_context_t *context){
+	size_t entered_count = __atomic_load_n(&context->entered_count, __ATOMIC_ACQUIRE);
+	if (entered_count > 0) {
+		warn("context_destroy: context %p is still entered %zu times, leave it first", context, entered_count);
+		return false;
+	}
+	
+	bci_destroy(context->interpreter);
+	gc_free(context);
+	return true;
+}
+
+
+// Makes `context` (or no context with NULL) current without touching the entered counts
+static void switch_to(lisp_context_t *context){
+	current_context = context;
+	bci_set_current(context ? context->interpreter : NULL);
+	log_setup(context ? context->log_level : 0, context ? context->log_os : NULL);
+}
+
+/**
+ * Makes `context` the current context of the calling thread. All evaluation on this thread uses
+ * the interpreter and log settings of the context from now on. Returns the previously entered
+ * context so it can be restored with context_leave().
+ */
+lisp_context_t* context_enter(lisp_context_t *context){
+	if (current_context == NULL && gc_register_thread())
+		registered_thread = true;
+	
+	__atomic_add_fetch(&context->entered_count, 1, __ATOMIC_RELAXED);
+	lisp_context_t *previous = current_context;
+	switch_to(context);
+	return previous;
+}
+
+/**
+ * Leaves the current context and enters `previous` again. With NULL the thread doesn't have a
+ * context anymore and is unregistered from the collector if context_enter() registered it.
+ */
+void context_leave(lisp_context_t *previous){
+	if (current_context != NULL)
+		__atomic_sub_fetch(&current_context->entered_count, 1, __ATOMIC_RELEASE);
+	
+	// The previous context is still counted from when it was entered
+	if (previous != NULL) {
+		switch_to(previous);
+		return;
+	}
+	
+	switch_to(NULL);
+	if (registered_thread) {
+		registered_thread = false;
+		gc_unregister_thread();
+	}
+}
+
+lisp_context_t* context_current(){
+	return current_context;
+}
+
+
+/**
+ * Evaluates `expr` in the global environment of `context`. The context has to be entered by the
+ * calling thread.
+ */
+atom_t* context_eval(lisp_context_t *context, atom_t *expr){
+	if (context != current_context) {
+		warn("context_eval: context %p is not entered by this thread", context);
+		return nil_atom();
+	}
+	
+	return eval_atom(expr, context->env);
+}
+
+/**
+ * Reads and evaluates all expressions in `code` and returns the result of the last one.
+ */
+atom_t* context_eval_str(lisp_context_t *context, char *code){
+	scanner_t scan = scan_open_string(code);
+	atom_t *result = nil_atom();
+	
+	while ( scan_peek(&scan) != EOF ) {
+		atom_t *expr = read_atom(&scan);
+		result = context_eval(context, expr);
+	}
+	
+	scan_close(&scan);
+	return result;
+}
\ No newline at end of file
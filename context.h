@@ -0,0 +1,47 @@
+#ifndef _CONTEXT_H
+#define _CONTEXT_H
+
+/**
+ * A context is an isolated instance of the interpreter: it owns its global environment, its
+ * bytecode interpreter (and with it the stack) and its log settings. Contexts don't share any
+ * mutable state, so different contexts can run at the same time in different threads.
+ *
+ * memory_init() has to be called once by the main thread before the first context is created.
+ * A thread enters a context before it evaluates anything in it. Threads not created by the
+ * collector are registered with it when they enter their first context and unregistered when
+ * they leave it again.
+ *
+ * A context must only be entered by one thread at a time. Atoms must not be passed from one
+ * context to another. Only the nil, true and false singletons are shared by all contexts.
+ *
+ * Every thread has to leave a context before it's destroyed. context_destroy() refuses to free a
+ * context that is still entered by any thread, including the calling one (as its current context
+ * or further down in its context stack).
+ */
+
+#include <stdbool.h>
+#include "memory.h"
+#include "output_stream.h"
+#include "bytecode_interpreter.h"
+
+typedef struct {
+	env_t *env;
+	bytecode_interpreter_t interpreter;
+	// Applied by context_enter(), see log_setup()
+	int log_level;
+	output_stream_t *log_os;
+	// Number of context_enter() calls not yet balanced by a context_leave(), changed atomically
+	size_t entered_count;
+} lisp_context_t;
+
+lisp_context_t* context_new(bool compile_lambdas);
+bool context_destroy(lisp_context_t *context);
+
+lisp_context_t* context_enter(lisp_context_t *context);
+void context_leave(lisp_context_t *previous);
+lisp_context_t* context_current();
+
+atom_t* context_eval(lisp_context_t *context, atom_t *expr);
+atom_t* context_eval_str(lisp_context_t *context, char *code);
+
+#endif
\ No newline at end of file
@@ -4,9 +4,29 @@
 #include "eval.h"
 #include "bytecode_interpreter.h"
 
+/**
+ * Checks that a lambda with a rest parameter gets at least its fixed arguments. Warns with the
+ * same message as the bytecode interpreter if not. Lambdas without a rest parameter aren't
+ * checked, their missing arguments just stay unbound.
+ */
+bool eval_check_rest_args(atom_t *lambda, size_t arg_count){
+	size_t fixed_count = 0;
+	atom_t *arg_name_pair = lambda->args;
+	for(; arg_name_pair->type == T_PAIR; arg_name_pair = arg_name_pair->rest)
+		fixed_count++;
+	
+	if (arg_name_pair->type == T_SYM && arg_count < fixed_count) {
+		warn("Wrong number of arguments for function! Got %zu, required %zu", arg_count, fixed_count);
+		return false;
+	}
+	return true;
+}
+
 atom_t *eval_atom(atom_t *atom, env_t *env){
 	if (atom->type < T_COMPLEX_ATOM) {
 		return atom;
+	} else if (atom->type == T_VALUE) {
+		return atom->boxed;
 	} else if (atom->type == T_SYM) {
 		atom_t *result = env_get(env, atom->sym);
 		if (result != NULL)
@@ -25,6 +45,12 @@ atom_t *eval_atom(atom_t *atom, env_t *env){
 				break;
 			case T_LAMBDA:
 				{
+					size_t arg_count = 0;
+					for(atom_t *arg = args; arg->type == T_PAIR; arg = arg->rest)
+						arg_count++;
+					if ( !eval_check_rest_args(evaled_function_slot, arg_count) )
+						return nil_atom();
+					
 					env_t *lambda_env = env_alloc(evaled_function_slot->env);
 					
 					// Eval and bind lambda args
@@ -35,15 +61,29 @@ atom_t *eval_atom(atom_t *atom, env_t *env){
 						arg_value_pair = arg_value_pair->rest;
 					}
 					
+					// A rest parameter gets a list of the remaining args
+					if (arg_name_pair->type == T_SYM) {
+						atom_t *rest = nil_atom(), **next = &rest;
+						for(; arg_value_pair->type == T_PAIR; arg_value_pair = arg_value_pair->rest){
+							*next = pair_atom_alloc(eval_atom(arg_value_pair->first, env), nil_atom());
+							next = &(*next)->rest;
+						}
+						env_def(lambda_env, arg_name_pair->sym, rest);
+					}
+					
 					return eval_atom(evaled_function_slot->body, lambda_env);
 				}
 				break;
 			
 			case T_RUNTIME_LAMBDA: {
-				bytecode_interpreter_t interpreter = bci_new(0);
-				atom_t *result = bci_eval(interpreter, evaled_function_slot, args, env);
-				bci_destroy(interpreter);
-				return result;
+				// Eval the args, the bytecode expects the values of its arguments
+				atom_t *evaled_args = nil_atom(), **next_arg = &evaled_args;
+				for(atom_t *arg = args; arg->type == T_PAIR; arg = arg->rest){
+					*next_arg = pair_atom_alloc(eval_atom(arg->first, env), nil_atom());
+					next_arg = &(*next_arg)->rest;
+				}
+				
+				return bci_eval(bci_current(), evaled_function_slot, evaled_args, env);
 				} break;
 			
 			case T_CUSTOM:
@@ -58,4 +98,57 @@ atom_t *eval_atom(atom_t *atom, env_t *env){
 	}
 	warn("Got unknown atom, type: %d", atom->type);
 	return nil_atom();
+}
+
+/**
+ * Builds the argument list for a buildin out of values that are already evaluated. Buildins eval
+ * their arguments, so values that don't eval to themselves are wrapped into T_VALUE atoms. These
+ * eval to the wrapped value without an env lookup.
+ */
+atom_t* eval_buildin_args(atom_t **args, size_t arg_count){
+	atom_t *arg_atoms = nil_atom();
+	for(size_t i = arg_count; i > 0; i--){
+		atom_t *arg = args[i-1];
+		if (arg->type >= T_COMPLEX_ATOM)
+			arg = value_atom_alloc(arg);
+		arg_atoms = pair_atom_alloc(arg, arg_atoms);
+	}
+	return arg_atoms;
+}
+
+/**
+ * Calls `function` with arguments that are already evaluated. Compiled lambdas are entered
+ * directly with bci_call(). Used by buildins that call functions passed to them (e.g. map).
+ */
+atom_t *eval_apply(atom_t *function, atom_t **args, size_t arg_count, env_t *env){
+	switch(function->type){
+		case T_RUNTIME_LAMBDA:
+			return bci_call(bci_current(), function, args, arg_count, env);
+		
+		case T_BUILDIN:
+			return function->func(eval_buildin_args(args, arg_count), env);
+		
+		case T_LAMBDA: {
+			if ( !eval_check_rest_args(function, arg_count) )
+				return nil_atom();
+			
+			env_t *lambda_env = env_alloc(function->env);
+			atom_t *arg_name_pair = function->args;
+			size_t i = 0;
+			for(; i < arg_count && arg_name_pair->type == T_PAIR; i++, arg_name_pair = arg_name_pair->rest)
+				env_def(lambda_env, arg_name_pair->first->sym, args[i]);
+			
+			if (arg_name_pair->type == T_SYM) {
+				atom_t *rest = nil_atom();
+				for(size_t j = arg_count; j > i; j--)
+					rest = pair_atom_alloc(args[j-1], rest);
+				env_def(lambda_env, arg_name_pair->sym, rest);
+			}
+			return eval_atom(function->body, lambda_env);
+			} break;
+		
+		default:
+			warn("Can't call an atom of type %d", function->type);
+			return nil_atom();
+	}
 }
\ No newline at end of file
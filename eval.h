@@ -4,5 +4,8 @@
 #include "memory.h"
 
 atom_t *eval_atom(atom_t *atom, env_t *env);
+bool eval_check_rest_args(atom_t *lambda, size_t arg_count);
+atom_t* eval_buildin_args(atom_t **args, size_t arg_count);
+atom_t *eval_apply(atom_t *function, atom_t **args, size_t arg_count, env_t *env);
 
 #endif
\ No newline at end of file
@@ -1,6 +1,8 @@
 // Use the Boehm-Demers-Weiser conservative garbage collector for now.
 // This file has to be included before the local gc.h. Otherwise the macros will
 // not be expanded properly (no idea why).
+// GC_THREADS enables the thread support of the collector, it has to be defined before gc.h.
+#define GC_THREADS
 #include <gc/gc.h>
 #include <stdio.h>
 #include <assert.h>
@@ -10,6 +12,26 @@
 
 void gc_init(){
 	GC_INIT();
+	GC_allow_register_threads();
+}
+
+bool gc_register_thread(){
+	if ( GC_thread_is_registered() )
+		return false;
+	
+	struct GC_stack_base stack_base;
+	GC_get_stack_base(&stack_base);
+	GC_register_my_thread(&stack_base);
+	return true;
+}
+
+void gc_unregister_thread(){
+	GC_unregister_my_thread();
+}
+
+int gc_thread_create(pthread_t *thread, void *(*func)(void*), void *arg){
+	// With GC_THREADS gc.h redirects this to GC_pthread_create()
+	return pthread_create(thread, NULL, func, arg);
 }
 
 void *gc_alloc(size_t size){
@@ -20,6 +42,10 @@ void *gc_alloc(size_t size){
 	return GC_MALLOC(size);
 }
 
+void *gc_alloc_atomic(size_t size){
+	return GC_MALLOC_ATOMIC(size);
+}
+
 void *gc_realloc(void *ptr, size_t size){
 	/*
 	if (size > 100)
@@ -34,4 +60,20 @@ void gc_free(void *ptr){
 
 size_t gc_heap_size(){
 	return GC_get_heap_size();
+}
+
+void gc_register_finalizer(void *obj, gc_finalizer_t func, void *data){
+	GC_REGISTER_FINALIZER(obj, func, data, NULL, NULL);
+}
+
+void *gc_alloc_uncollectable(size_t size){
+	return GC_MALLOC_UNCOLLECTABLE(size);
+}
+
+void gc_pool_refill(gc_pool_t *pool){
+	pool->free_list = GC_malloc_many(pool->object_size);
+	// Fall back to a list with one object if the collector could not give us a batch
+	if (pool->free_list == NULL)
+		pool->free_list = GC_MALLOC(pool->object_size);
+	assert(pool->free_list != NULL);
 }
\ No newline at end of file
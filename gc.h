@@ -4,11 +4,56 @@
 // The simple _GC_H guard would prevent the real collectors gc.h from being included. Therefore use a more local guard.
 
 #include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
 
 void gc_init();
 void *gc_alloc(size_t size);
+// For memory without pointers to other objects (e.g. digits of a bignum). The collector doesn't
+// scan it and doesn't clear it either.
+void *gc_alloc_atomic(size_t size);
 void *gc_realloc(void *ptr, size_t size);
 void gc_free(void *ptr);
 size_t gc_heap_size();
 
+// Calls `func` with `obj` and `data` once `obj` is no longer reachable. For resources outside of
+// the heap, e.g. memory mapped files.
+typedef void (*gc_finalizer_t)(void *obj, void *data);
+void gc_register_finalizer(void *obj, gc_finalizer_t func, void *data);
+
+// Threads not created by the collector have to register themselves before they use the heap
+// and unregister before they exit. gc_init() has to be called by the main thread first.
+// gc_register_thread() returns false if the thread was already registered.
+bool gc_register_thread();
+void gc_unregister_thread();
+// Creates a thread that is registered with the collector for its whole lifetime
+int gc_thread_create(pthread_t *thread, void *(*func)(void*), void *arg);
+
+
+/**
+ * Pools hand out objects of one fixed size and are refilled in bulk from the collector. Each
+ * pooled object is still collected individually. The pool struct itself has to live in memory
+ * the collector scans (e.g. allocated with `gc_alloc_uncollectable()`), otherwise the objects
+ * waiting in the free list could be collected and handed out twice.
+ */
+typedef struct {
+	size_t object_size;
+	void *free_list;
+} gc_pool_t;
+
+void *gc_alloc_uncollectable(size_t size);
+void gc_pool_refill(gc_pool_t *pool);
+
+static inline void *gc_pool_alloc(gc_pool_t *pool){
+	if (pool->free_list == NULL)
+		gc_pool_refill(pool);
+	
+	// The free list is linked through the first word of each object, everything else is
+	// already cleared by the collector.
+	void *ptr = pool->free_list;
+	pool->free_list = *(void**)ptr;
+	*(void**)ptr = NULL;
+	return ptr;
+}
+
 #endif
\ No newline at end of file
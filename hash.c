@@ -0,0 +1,197 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash.h"
+#include "bignum.h"
+#include "str.h"
+
+#define HASH_MIN_CAPACITY 8
+
+// Key of deleted slots. Only its address is used.
+static atom_t deleted_key;
+
+
+//
+// Hash functions
+//
+
+// Finalizer of SplitMix64, spreads the bits of integers and pointers over all 64 bits
+static uint64_t mix(uint64_t x){
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+// FNV-1a
+static uint64_t hash_bytes(const void *data, size_t length){
+	const uint8_t *bytes = data;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for(size_t i = 0; i < length; i++){
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+uint64_t hash_of_atom(atom_t *atom){
+	switch(atom->type){
+		case T_NUM:
+			return mix(atom->num);
+		case T_FLOAT: {
+			// 0.0 and -0.0 are equal and need the same hash
+			double value = (atom->real == 0) ? 0 : atom->real;
+			uint64_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			return mix(bits);
+			}
+		case T_BIGNUM:
+			return hash_bytes(atom->bignum->digits, atom->bignum->length * sizeof(uint32_t)) ^ atom->bignum->negative;
+		case T_STR:
+			return hash_bytes(atom->str, atom->str_length);
+		case T_SYM:
+			return hash_bytes(atom->sym, strlen(atom->sym));
+		default:
+			return mix((uintptr_t)atom);
+	}
+}
+
+static bool keys_equal(atom_t *a, atom_t *b){
+	if (a == b)
+		return true;
+	if (a->type != b->type)
+		return false;
+	
+	switch(a->type){
+		case T_NUM:
+			return a->num == b->num;
+		case T_FLOAT:
+			return a->real == b->real;
+		case T_BIGNUM:
+			return bignum_cmp(a->bignum, b->bignum) == 0;
+		case T_STR:
+			return str_equal(a, b);
+		case T_SYM:
+			return strcmp(a->sym, b->sym) == 0;
+		default:
+			return false;
+	}
+}
+
+
+//
+// Hash tables
+//
+
+hash_t* hash_new(size_t capacity){
+	size_t slot_count = HASH_MIN_CAPACITY;
+	while (slot_count < capacity)
+		slot_count *= 2;
+	
+	hash_t *hash = gc_alloc(sizeof(hash_t));
+	hash->length = 0;
+	hash->deleted = 0;
+	hash->capacity = slot_count;
+	hash->slots = gc_alloc(slot_count * sizeof(hash_slot_t));
+	return hash;
+}
+
+/**
+ * Returns the slot of `key`. If the key isn't in the table the returned slot is the one where it
+ * would be inserted (an empty or deleted slot). There is always at least one empty slot so the
+ * probing ends.
+ */
+static hash_slot_t* hash_find(hash_t *hash, atom_t *key, uint64_t key_hash){
+	size_t mask = hash->capacity - 1;
+	hash_slot_t *first_deleted = NULL;
+	
+	for(size_t i = key_hash & mask; true; i = (i + 1) & mask){
+		hash_slot_t *slot = &hash->slots[i];
+		if (slot->key == NULL)
+			return (first_deleted != NULL) ? first_deleted : slot;
+		else if (slot->key == &deleted_key)
+			first_deleted = (first_deleted != NULL) ? first_deleted : slot;
+		else if ( slot->hash == key_hash && keys_equal(slot->key, key) )
+			return slot;
+	}
+}
+
+/**
+ * Moves all entries into a new slot array with room for `capacity` entries. Deleted slots are
+ * dropped on the way.
+ */
+static void hash_resize(hash_t *hash, size_t capacity){
+	hash_slot_t *old_slots = hash->slots;
+	size_t old_capacity = hash->capacity;
+	
+	hash->capacity = capacity;
+	hash->slots = gc_alloc(capacity * sizeof(hash_slot_t));
+	hash->deleted = 0;
+	
+	for(size_t i = 0; i < old_capacity; i++){
+		if (old_slots[i].key != NULL && old_slots[i].key != &deleted_key)
+			*hash_find(hash, old_slots[i].key, old_slots[i].hash) = old_slots[i];
+	}
+	
+	gc_free(old_slots);
+}
+
+/**
+ * Returns the value of `key` or NULL if the key isn't in the table.
+ */
+atom_t* hash_get(hash_t *hash, atom_t *key){
+	hash_slot_t *slot = hash_find(hash, key, hash_of_atom(key));
+	return (slot->key != NULL && slot->key != &deleted_key) ? slot->value : NULL;
+}
+
+void hash_put(hash_t *hash, atom_t *key, atom_t *value){
+	// Keep the load (including deleted slots) below 3/4. Grow only if the entries themselves need
+	// the room, otherwise rehashing to get rid of the deleted slots is enough.
+	if ( (hash->length + hash->deleted + 1) * 4 > hash->capacity * 3 ) {
+		size_t capacity = hash->capacity;
+		if ( (hash->length + 1) * 2 > capacity )
+			capacity *= 2;
+		hash_resize(hash, capacity);
+	}
+	
+	uint64_t key_hash = hash_of_atom(key);
+	hash_slot_t *slot = hash_find(hash, key, key_hash);
+	if (slot->key == NULL || slot->key == &deleted_key) {
+		if (slot->key == &deleted_key)
+			hash->deleted--;
+		hash->length++;
+		slot->key = key;
+		slot->hash = key_hash;
+	}
+	slot->value = value;
+}
+
+/**
+ * Removes `key` from the table. Returns false if it wasn't in there.
+ */
+bool hash_delete(hash_t *hash, atom_t *key){
+	hash_slot_t *slot = hash_find(hash, key, hash_of_atom(key));
+	if (slot->key == NULL || slot->key == &deleted_key)
+		return false;
+	
+	slot->key = &deleted_key;
+	slot->value = NULL;
+	hash->length--;
+	hash->deleted++;
+	return true;
+}
+
+/**
+ * Returns a list of all keys in the table. The order is unspecified.
+ */
+atom_t* hash_keys(hash_t *hash){
+	atom_t *keys = nil_atom();
+	for(size_t i = hash->capacity; i > 0; i--){
+		hash_slot_t *slot = &hash->slots[i-1];
+		if (slot->key != NULL && slot->key != &deleted_key)
+			keys = pair_atom_alloc(slot->key, keys);
+	}
+	return keys;
+}
\ No newline at end of file
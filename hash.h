@@ -0,0 +1,36 @@
+#ifndef _HASH_H
+#define _HASH_H
+
+/**
+ * Hash tables with open addressing (linear probing). Numbers, strings and symbols are compared
+ * by value, all other atoms by identity. Symbols aren't interned so they're hashed by their name.
+ * Integers and floats are different keys, e.g. 1 and 1.0 are two entries.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "memory.h"
+
+typedef struct {
+	// NULL if the slot is empty
+	atom_t *key;
+	atom_t *value;
+	uint64_t hash;
+} hash_slot_t;
+
+struct hash {
+	// Number of entries and number of slots (always a power of 2)
+	size_t length, capacity;
+	// Slots of deleted entries. Lookups have to probe past them so they count towards the load.
+	size_t deleted;
+	hash_slot_t *slots;
+};
+
+hash_t* hash_new(size_t capacity);
+uint64_t hash_of_atom(atom_t *atom);
+atom_t* hash_get(hash_t *hash, atom_t *key);
+void hash_put(hash_t *hash, atom_t *key, atom_t *value);
+bool hash_delete(hash_t *hash, atom_t *key);
+atom_t* hash_keys(hash_t *hash);
+
+#endif
\ No newline at end of file
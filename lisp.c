@@ -9,10 +9,10 @@
 #include <stdlib.h>
 
 #include "memory.h"
+#include "context.h"
 #include "reader.h"
 #include "printer.h"
 #include "eval.h"
-#include "buildins.h"
 #include "bytecode_interpreter.h"
 #include "bytecode_compiler.h"
 
@@ -35,15 +35,13 @@ int main(int argc, char **argv){
 	parse_opts(argc, argv, &opts);
 	
 	memory_init();
-	env_t *env = env_alloc(NULL);
-	
-	register_buildins_in(env);
-	env_def(env, "__compile_lambdas", opts.compile ? true_atom() : false_atom());
+	lisp_context_t *context = context_new(opts.compile);
+	context_enter(context);
 	
 	if (opts.input_file == NULL)
-		return repl(env, &opts);
+		return repl(context->env, &opts);
 	else
-		return interprete_files(env, &opts);
+		return interprete_files(context->env, &opts);
 }
 
 /**
@@ -94,12 +92,10 @@ int interprete_files(env_t *env, options_p opts){
 			current_pair = current_pair->rest;
 		}
 		
-		bytecode_interpreter_t interpreter = bci_new(1024);
 		atom_t *cl = bcc_compile_to_lambda(nil_atom(), prog, env, NULL);
 		atom_t *rl = runtime_lambda_atom_alloc(cl, scope_env_alloc(env));
 		
-		bci_eval(interpreter, rl, nil_atom(), env);
-		bci_destroy(interpreter);
+		bci_eval(bci_current(), rl, nil_atom(), env);
 	} else {
 		// Do a normal repl but without prompt and printing
 		while ( scan_peek(&scan) != EOF ){
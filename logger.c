@@ -3,16 +3,28 @@
 
 #include "logger.h"
 
-int log_level = 0;
-output_stream_t *log_os = NULL;
+// Each thread has its own log settings, see context_enter()
+static __thread int log_level = 0;
+static __thread output_stream_t *log_os = NULL;
+static __thread bool log_muted = false;
 
 void log_setup(int level, output_stream_t *os){
 	log_level = level;
 	log_os = os;
 }
 
+/**
+ * Drops all messages of the calling thread while muted. Returns the previous state so nested
+ * callers can restore it.
+ */
+bool log_mute(bool mute){
+	bool previous = log_muted;
+	log_muted = mute;
+	return previous;
+}
+
 void log_printf(int level, const char *file, int line, const char *func, const char *format, ...){
-	if (level < log_level)
+	if (level < log_level || log_muted)
 		return;
 	
 	char *label = NULL;
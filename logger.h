@@ -2,9 +2,11 @@
 #define _LOGGER_H
 
 /**
- * A simple logger which prefixes each message with the source code location.
+ * A simple logger which prefixes each message with the source code location. The settings of
+ * log_setup() only apply to the calling thread.
  */
 
+#include <stdbool.h>
 #include "output_stream.h"
 
 #define LOG_INFO 1
@@ -12,6 +14,7 @@
 #define LOG_ERROR 3
 
 void log_setup(int level, output_stream_t *os);
+bool log_mute(bool mute);
 void log_printf(int level, const char *file, int line, const char *func, const char *format, ...);
 
 #define info(...) log_printf(LOG_INFO, __FILE__, __LINE__, __func__, __VA_ARGS__)
@@ -1,5 +1,7 @@
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <assert.h>
 
 #include "logger.h"
 #include "memory.h"
@@ -7,9 +9,50 @@
 // Global singleton atoms
 atom_t *allocator_nil_atom, *allocator_true_atom, *allocator_false_atom;
 
+// Allocation pools for the structures we allocate most often. Each thread gets its own pools so
+// allocating doesn't need any locking. The pools are allocated uncollectable because the
+// collector doesn't scan thread local storage. They're freed when the thread exits, the objects
+// left in their free lists are then collected.
+typedef struct {
+	gc_pool_t atoms, scopes, envs;
+} memory_pools_t;
+
+static __thread memory_pools_t *allocator_pools = NULL;
+static pthread_key_t allocator_pools_key;
+static pthread_once_t allocator_pools_key_once = PTHREAD_ONCE_INIT;
+
+static void free_memory_pools(void *pools){
+	allocator_pools = NULL;
+	gc_free(pools);
+}
+
+static void create_memory_pools_key(){
+	pthread_key_create(&allocator_pools_key, free_memory_pools);
+}
+
+static memory_pools_t* create_memory_pools(){
+	memory_pools_t *pools = gc_alloc_uncollectable(sizeof(memory_pools_t));
+	*pools = (memory_pools_t){
+		.atoms = { .object_size = sizeof(atom_t), .free_list = NULL },
+		.scopes = { .object_size = sizeof(scope_t), .free_list = NULL },
+		.envs = { .object_size = sizeof(env_t), .free_list = NULL }
+	};
+	
+	// The key only exists to run the destructor when the thread exits
+	pthread_once(&allocator_pools_key_once, create_memory_pools_key);
+	pthread_setspecific(allocator_pools_key, pools);
+	return pools;
+}
+
+static inline memory_pools_t* memory_pools(){
+	if (allocator_pools == NULL)
+		allocator_pools = create_memory_pools();
+	return allocator_pools;
+}
+
 // Private atom allocator function. Every atom comes from here.
 atom_t* atom_alloc(uint8_t type){
-	atom_t *ptr = gc_alloc(sizeof(atom_t));
+	atom_t *ptr = gc_pool_alloc(&memory_pools()->atoms);
 	ptr->type = type;
 	return ptr;
 }
@@ -42,6 +85,18 @@ atom_t* num_atom_alloc(int64_t value){
 	return atom;
 }
 
+atom_t* bignum_atom_alloc(bignum_t *value){
+	atom_t *atom = atom_alloc(T_BIGNUM);
+	atom->bignum = value;
+	return atom;
+}
+
+atom_t* float_atom_alloc(double value){
+	atom_t *atom = atom_alloc(T_FLOAT);
+	atom->real = value;
+	return atom;
+}
+
 atom_t* sym_atom_alloc(char *sym){
 	atom_t *atom = atom_alloc(T_SYM);
 	atom->sym = sym;
@@ -49,8 +104,19 @@ atom_t* sym_atom_alloc(char *sym){
 }
 
 atom_t* str_atom_alloc(char *str){
+	return str_slice_atom_alloc(str, strlen(str));
+}
+
+atom_t* str_slice_atom_alloc(char *str, size_t length){
 	atom_t *atom = atom_alloc(T_STR);
 	atom->str = str;
+	atom->str_length = length;
+	return atom;
+}
+
+atom_t* str_builder_atom_alloc(str_builder_t *builder){
+	atom_t *atom = atom_alloc(T_STR_BUILDER);
+	atom->builder = builder;
 	return atom;
 }
 
@@ -66,10 +132,42 @@ atom_t* pair_atom_alloc(atom_t *first, atom_t *rest){
 	return atom;
 }
 
+atom_t* vector_atom_alloc(size_t length, atom_t *fill){
+	atom_t *atom = atom_alloc(T_VECTOR);
+	atom->length = length;
+	atom->elements = gc_alloc(length * sizeof(atom_t*));
+	for(size_t i = 0; i < length; i++)
+		atom->elements[i] = fill;
+	return atom;
+}
+
+atom_t* hash_atom_alloc(hash_t *hash){
+	atom_t *atom = atom_alloc(T_HASH);
+	atom->hash = hash;
+	return atom;
+}
+
+// The task is set by whoever submits it, see buildin_future()
+atom_t* future_atom_alloc(){
+	atom_t *atom = atom_alloc(T_FUTURE);
+	atom->future.task = NULL;
+	atom->future.result = nil_atom();
+	return atom;
+}
+
+atom_t* array_atom_alloc(uint8_t kind, void *data, size_t length){
+	atom_t *atom = atom_alloc(T_ARRAY);
+	atom->array.kind = kind;
+	atom->array.data = data;
+	atom->array.length = length;
+	return atom;
+}
+
 atom_t* buildin_atom_alloc(buildin_func_t func, compile_func_t compile_func){
 	atom_t *atom = atom_alloc(T_BUILDIN);
 	atom->func = func;
 	atom->compile_func = compile_func;
+	atom->buildin_flags = 0;
 	return atom;
 }
 
@@ -83,14 +181,26 @@ atom_t* lambda_atom_alloc(atom_t *args, atom_t *body, env_t *env){
 
 atom_t* compiled_lambda_atom_alloc(bytecode_t bytecode, atom_list_t literal_table, uint16_t arg_count, uint16_t var_count){
 	atom_t *atom = atom_alloc(T_COMPILED_LAMBDA);
-	atom->bytecode = bytecode;
-	atom->literal_table = literal_table;
-	
 	atom->comp_data = gc_alloc(sizeof(struct compiler_data));
+	atom->comp_data->bytecode = bytecode;
+	atom->comp_data->literal_table = literal_table;
 	atom->comp_data->arg_count = arg_count;
 	atom->comp_data->var_count = var_count;
+	atom->comp_data->has_rest = false;
 	atom->comp_data->names = NULL;
 	atom->comp_data->max_frame_offset = 0;
+	atom->comp_data->max_stack_depth = 0;
+	atom->comp_data->parent = NULL;
+	atom->comp_data->capture_count = 0;
+	atom->comp_data->captures = NULL;
+	atom->comp_data->boxed_count = 0;
+	atom->comp_data->boxed_locals = NULL;
+	atom->comp_data->local_count = var_count;
+	atom->comp_data->let_store_count = 0;
+	atom->comp_data->let_stores = NULL;
+	atom->comp_data->free_temp_count = 0;
+	atom->comp_data->free_temps = NULL;
+	compiled_lambda_analyze(atom);
 	
 	return atom;
 }
@@ -99,6 +209,7 @@ atom_t* runtime_lambda_atom_alloc(atom_t *compiled_lambda, scope_p scopes){
 	atom_t *atom = atom_alloc(T_RUNTIME_LAMBDA);
 	atom->cl = compiled_lambda;
 	atom->scopes = scopes;
+	atom->captured = NULL;
 	return atom;
 }
 
@@ -116,52 +227,211 @@ atom_t* custom_atom_alloc(uint64_t type, void *data, buildin_func_t func){
 	return atom;
 }
 
-atom_t* interpreter_state_atom_alloc(size_t fp_index, size_t ip_index, size_t arg_count, uint8_t scope_escaped, scope_p frame_scope){
+atom_t* interpreter_state_atom_alloc(size_t fp_index, size_t ip_index, size_t arg_count, scope_p frame_scope){
 	atom_t *atom = atom_alloc(T_INTERPRETER_STATE);
 	atom->interpreter_state.fp_index = fp_index;
 	atom->interpreter_state.ip_index = ip_index;
 	atom->interpreter_state.arg_count = arg_count;
 	atom->interpreter_state.padding = 0;
-	atom->interpreter_state.scope_escaped = scope_escaped;
 	atom->interpreter_state.frame_scope = frame_scope;
 	return atom;
 }
 
+atom_t* box_atom_alloc(atom_t *value){
+	atom_t *atom = atom_alloc(T_BOX);
+	atom->boxed = value;
+	return atom;
+}
+
+atom_t* value_atom_alloc(atom_t *value){
+	atom_t *atom = atom_alloc(T_VALUE);
+	atom->boxed = value;
+	return atom;
+}
+
+
+/**
+ * Returns by how much an instruction changes the number of atoms on the stack.
+ */
+static ssize_t instruction_stack_effect(instruction_t *ins){
+	switch(ins->op){
+		case BC_LOAD_NIL: case BC_LOAD_TRUE: case BC_LOAD_FALSE: case BC_LOAD_NUM:
+		case BC_LOAD_LITERAL: case BC_LOAD_LAMBDA: case BC_LOAD_ARG: case BC_LOAD_LOCAL:
+		case BC_LOAD_ENV: case BC_LOAD_CAPTURED: case BC_LOAD_BOXED_CAPTURED: case BC_LOAD_BOXED_LOCAL:
+		case BC_LOAD_REST:
+			return 1;
+		case BC_DROP: case BC_JUMP_IF_FALSE:
+		case BC_ADD: case BC_SUB: case BC_MUL: case BC_DIV: case BC_MOD:
+		case BC_EQ: case BC_LT: case BC_GT: case BC_CONS: case BC_VREF:
+			return -1;
+		case BC_VSET:
+			return -2;
+		case BC_CALL: case BC_APPLY:
+			// Pops the function and its arguments, pushes the result. The interpreter reserves the
+			// space for the elements BC_APPLY spreads on the stack itself.
+			return -(ssize_t)ins->num;
+		default:
+			// Stores, BC_FIRST, BC_REST, jumps and BC_RETURN
+			return 0;
+	}
+}
+
+// Instructions still to visit by bytecode_max_stack_depth(). depths is -1 for instructions that
+// weren't reached yet.
+typedef struct {
+	size_t length;
+	ssize_t *depths;
+	size_t *worklist;
+	size_t worklist_length;
+} stack_depth_walk_t;
+
+static void stack_depth_visit(stack_depth_walk_t *walk, size_t index, ssize_t depth){
+	if (index >= walk->length || walk->depths[index] != -1)
+		return;
+	walk->depths[index] = depth;
+	walk->worklist[walk->worklist_length++] = index;
+}
+
+/**
+ * Computes the maximal stack depth of the bytecode by following all branches through the
+ * bytecode. Each instruction is visited once. The compiler always generates code where the
+ * stack depth at an instruction is the same on every path leading to it.
+ */
+static size_t bytecode_max_stack_depth(bytecode_t *bytecode){
+	if (bytecode->length == 0)
+		return 0;
+	
+	stack_depth_walk_t walk = {
+		.length = bytecode->length,
+		.depths = gc_alloc_atomic(bytecode->length * sizeof(ssize_t)),
+		.worklist = gc_alloc_atomic(bytecode->length * sizeof(size_t)),
+		.worklist_length = 0
+	};
+	for(size_t i = 0; i < bytecode->length; i++)
+		walk.depths[i] = -1;
+	
+	size_t max_depth = 0;
+	stack_depth_visit(&walk, 0, 0);
+	while(walk.worklist_length > 0){
+		size_t i = walk.worklist[--walk.worklist_length];
+		instruction_t *ins = &bytecode->code[i];
+		
+		// A negative depth means the bytecode pops more than it pushed. The interpreter doesn't
+		// check the stack bounds anymore, so this has to be a bug in the compiler.
+		ssize_t depth = walk.depths[i] + instruction_stack_effect(ins);
+		assert(depth >= 0);
+		if ((size_t)depth > max_depth)
+			max_depth = depth;
+		
+		switch(ins->op){
+			case BC_RETURN:
+				break;
+			case BC_JUMP:
+				stack_depth_visit(&walk, i + 1 + ins->jump_offset, depth);
+				break;
+			case BC_JUMP_IF_FALSE:
+				stack_depth_visit(&walk, i + 1 + ins->jump_offset, depth);
+				stack_depth_visit(&walk, i + 1, depth);
+				break;
+			case BC_GUARD_INLINED:
+				stack_depth_visit(&walk, i + 1 + ins->offset, depth);
+				stack_depth_visit(&walk, i + 1, depth);
+				break;
+			default:
+				stack_depth_visit(&walk, i + 1, depth);
+				break;
+		}
+	}
+	
+	gc_free(walk.worklist);
+	gc_free(walk.depths);
+	return max_depth;
+}
+
+/**
+ * Scans the bytecode of a compiled lambda to find out how far it reaches into outer frames. Nested
+ * lambdas from the literal table are taken into account: if they reach two frames outwards we
+ * reach one frame outwards because their frames are created by us. Therefore nested lambdas have
+ * to be analyzed before their parents. Also computes the maximal stack depth of the bytecode.
+ * 
+ * The compiler calls this after the bytecode of a lambda is complete. Compiled lambdas that are
+ * allocated with finished bytecode (e.g. hand written bytecode) are analyzed on allocation.
+ */
+void compiled_lambda_analyze(atom_t *cl){
+	compiler_data_t cd = cl->comp_data;
+	
+	cd->max_frame_offset = 0;
+	for(size_t i = 0; i < cd->bytecode.length; i++){
+		instruction_t *ins = &cd->bytecode.code[i];
+		switch(ins->op){
+			case BC_LOAD_LITERAL: case BC_LOAD_LAMBDA:
+			case BC_LOAD_ARG: case BC_LOAD_LOCAL: case BC_STORE_LOCAL:
+				if (ins->offset > 0 && (size_t)ins->offset > cd->max_frame_offset)
+					cd->max_frame_offset = ins->offset;
+				break;
+		}
+	}
+	
+	for(size_t i = 0; i < cd->literal_table.length; i++){
+		atom_t *literal = cd->literal_table.atoms[i];
+		if (literal->type == T_COMPILED_LAMBDA && literal->comp_data->max_frame_offset > cd->max_frame_offset + 1)
+			cd->max_frame_offset = literal->comp_data->max_frame_offset - 1;
+	}
+	
+	cd->max_stack_depth = bytecode_max_stack_depth(&cd->bytecode);
+}
+
 
 //
 // Scope stuff
 //
 
+/**
+ * Builds the display of a new scope: itself followed by the display of the next scope. The
+ * display of the next scope is never changed so it can be copied.
+ */
+static void scope_build_display(scope_p scope){
+	scope_p next = scope->next;
+	scope->depth = (next != NULL) ? next->depth + 1 : 0;
+	scope->display = gc_alloc((scope->depth + 1) * sizeof(scope_p));
+	scope->display[0] = scope;
+	if (next != NULL)
+		memcpy(scope->display + 1, next->display, (next->depth + 1) * sizeof(scope_p));
+}
+
 scope_p scope_stack_alloc(scope_p next, uint16_t arg_count, size_t frame_index){
-	scope_p scope = gc_alloc(sizeof(scope_t));
+	scope_p scope = gc_pool_alloc(&memory_pools()->scopes);
 	*scope = (scope_t){
 		.next = next,
 		.arg_count = arg_count,
 		.type = SCOPE_STACK,
 		.frame_index = frame_index
 	};
+	scope_build_display(scope);
 	return scope;
 }
 
 scope_p scope_heap_alloc(scope_p next, uint16_t arg_count, atom_t **frame){
-	scope_p scope = gc_alloc(sizeof(scope_t));
+	scope_p scope = gc_pool_alloc(&memory_pools()->scopes);
 	*scope = (scope_t){
 		.next = next,
 		.arg_count = arg_count,
 		.type = SCOPE_HEAP,
 		.atoms = frame
 	};
+	scope_build_display(scope);
 	return scope;
 }
 
 scope_p scope_env_alloc(env_t *env){
-	scope_p scope = gc_alloc(sizeof(scope_t));
+	scope_p scope = gc_pool_alloc(&memory_pools()->scopes);
 	*scope = (scope_t){
 		.next = NULL,
 		.arg_count = 0,
 		.type = SCOPE_ENV,
 		.env = env
 	};
+	scope_build_display(scope);
 	return scope;
 }
 
@@ -171,7 +441,7 @@ scope_p scope_env_alloc(env_t *env){
 //
 
 env_t* env_alloc(env_t *parent){
-	env_t *env = gc_alloc(sizeof(env_t));
+	env_t *env = gc_pool_alloc(&memory_pools()->envs);
 	env->length = 0;
 	env->parent = parent;
 	env->bindings = NULL;
@@ -190,18 +460,40 @@ atom_t* env_get(env_t *env, char *key){
 	return env_get(env->parent, key);
 }
 
+/**
+ * Returns the index of the binding `key` in `env` itself (parent envs are not searched) or -1.
+ * Bindings are never removed, so the index stays valid.
+ */
+ssize_t env_binding_index(env_t *env, char *key){
+	for(int i = 0; i < env->length; i++){
+		if ( strcmp(env->bindings[i].key, key) == 0 )
+			return i;
+	}
+	return -1;
+}
+
 void env_def(env_t *env, char *key, atom_t *value){
 	if (env == NULL){
 		warn("Got NULL pointer as environment");
 		return;
 	}
 	
+	// Redefinitions replace the existing binding
+	for(int i = 0; i < env->length; i++){
+		if ( strcmp(env->bindings[i].key, key) == 0 ) {
+			env->bindings[i].version++;
+			env->bindings[i].value = value;
+			return;
+		}
+	}
+	
 	env->length++;
 	env->bindings = gc_realloc(env->bindings, env->length * sizeof(env_binding_t));
 	
 	env->bindings[env->length-1] = (env_binding_t){
 		.key = key,
-		.value = value
+		.value = value,
+		.version = 0
 	};
 	
 	return;
@@ -215,6 +507,7 @@ void env_set(env_t *env, char *key, atom_t *value){
 	
 	for(int i = 0; i < env->length; i++){
 		if ( strcmp(env->bindings[i].key, key) == 0 ) {
+			env->bindings[i].version++;
 			env->bindings[i].value = value;
 			return;
 		}
@@ -2,6 +2,7 @@
 #define _MEMORY_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "bytecode.h"
 #include "gc.h"
 
@@ -12,6 +13,10 @@
 typedef struct atom_s atom_t;
 typedef struct env_s env_t;
 typedef struct compiler_data *compiler_data_t;
+typedef struct bignum bignum_t;
+typedef struct hash hash_t;
+typedef struct str_builder str_builder_t;
+typedef struct pool_task pool_task_t;
 
 typedef struct {
 	size_t length;
@@ -24,8 +29,13 @@ typedef struct {
 #define SCOPE_ENV		2
 struct scope {
 	struct scope *next;
+	// Display of the scope chain: display[0] is this scope, display[i] the scope i steps up the
+	// chain and display[depth] the env scope at the end. Built once when the scope is allocated
+	// so the interpreter can reach any outer frame without walking the next pointers.
+	struct scope **display;
 	uint16_t arg_count;  // remembered per frame because of var args
 	uint16_t type;  // if SCOPE_STACK fi is the stack index of the frame, if SCOPE_HEAP atoms is the pointer to the frame atoms
+	uint16_t depth;  // number of scopes after this one in the chain
 	union {
 		size_t frame_index;
 		atom_t **atoms;
@@ -35,46 +45,123 @@ struct scope {
 typedef struct scope scope_t, *scope_p;
 
 
+// Where a flat closure gets a captured variable from when it's created: an argument or local of
+// the frame it's created in or a variable the creating lambda captured itself.
+#define CAPTURE_ARG		0
+#define CAPTURE_LOCAL		1
+#define CAPTURE_CAPTURED	2
+typedef struct {
+	char *name;
+	uint8_t source;
+	// Captured locals are shared with the frame (and other lambdas) through a box. Arguments
+	// can't be changed so their value is copied directly.
+	bool boxed;
+	uint32_t index;
+} capture_t;
+
+// Everything a compiled lambda needs. Kept out of the atom itself so the compiled lambda doesn't
+// blow up the size of all other atoms.
 struct compiler_data {
+	bytecode_t bytecode;
+	atom_list_t literal_table;
 	size_t arg_count, var_count;
+	// Lambdas with a rest parameter take arg_count or more arguments. The arguments after the first
+	// arg_count stay on the stack, see BC_LOAD_REST.
+	bool has_rest;
 	char **names;
 	// The number of frames this compiled lambda reaches outwards with its LOAD and STORE instructions
+	// (including the instructions of nested lambdas). If this is 0 the lambda doesn't need the frame
+	// it's created in and that frame never has to be captured for it. Set by compiled_lambda_analyze().
 	size_t max_frame_offset;
+	// The maximal number of atoms the bytecode pushes on the stack on top of the frame (without the
+	// frames of called lambdas). The interpreter makes sure this much space is available when it
+	// enters a frame so pushing doesn't need to check the stack size. Set by compiled_lambda_analyze().
+	size_t max_stack_depth;
 	// The lambda we were defined in. Can be a normal lambda or a compiled lambda.
 	atom_t *parent;
+	// Variables of outer lambdas this lambda uses. Their values (or boxes) are copied into
+	// the runtime lambda when it is created.
+	size_t capture_count;
+	capture_t *captures;
+	// Indices of the local variables that are captured by nested lambdas. These locals are
+	// stored in boxes.
+	size_t boxed_count;
+	uint32_t *boxed_locals;
+	// Number of local slots in use at the current point of the compilation. Slots above it
+	// (up to var_count) were used by let blocks that already ended and can be reused.
+	size_t local_count;
+	// Indices of the instructions that store the initial values of let bindings. If the local is
+	// boxed these create a new box instead of changing the value in the existing box.
+	size_t let_store_count;
+	size_t *let_stores;
+	// Released slots of hidden temporaries (see bcc_alloc_temp()). These slots are only reused by
+	// other temporaries, never by let bindings that might be boxed.
+	size_t free_temp_count;
+	uint32_t *free_temps;
 };
 
 
 typedef atom_t* (*buildin_func_t)(atom_t *args, env_t *env);
 typedef void (*compile_func_t)(atom_t *cl, atom_t *args, env_t *env);
 
+/**
+ * Every atom is a one byte type header followed by at most three words of payload. Pairs and
+ * numbers only use the first one or two words. Larger data (e.g. the bytecode and literal table
+ * of compiled lambdas) has to be moved behind a pointer to keep all atoms at 32 bytes.
+ */
 struct atom_s {
-	int64_t type;
+	uint8_t type;
 	union {
 		int64_t num;
+		// Only used for integers outside of the int64_t range, see bignum.h
+		bignum_t *bignum;
+		double real;
+		// See hash.h
+		hash_t *hash;
 		char *sym;
-		char *str;
+		// See str.h, str isn't always 0 terminated
+		struct {
+			char *str;
+			size_t str_length;
+		};
+		str_builder_t *builder;
+		// See pool.h, the worker sets the result before the task is done
+		struct {
+			pool_task_t *task;
+			atom_t *result;
+		} future;
 		struct {
 			atom_t *first, *rest;
 		};
+		struct {
+			atom_t **elements;
+			size_t length;
+		};
+		// See array.h, kind is one of the ARRAY_* constants
+		struct {
+			void *data;
+			size_t length;
+			uint8_t kind;
+		} array;
 		struct {
 			buildin_func_t func;
 			compile_func_t compile_func;
+			// See BUILDIN_* flags
+			uint64_t buildin_flags;
 		};
 		struct {
 			atom_t *body;
 			atom_t *args;
 			env_t *env;
 		};
-		struct {
-			bytecode_t bytecode;
-			atom_list_t literal_table;
-			compiler_data_t comp_data;
-		};
+		compiler_data_t comp_data;
 		struct {
 			atom_t *cl;
 			scope_p scopes;
+			// Values of the captured variables, see capture_count and captures of the compiler data
+			atom_t **captured;
 		};
+		atom_t *boxed;
 		struct {
 			uint64_t type;
 			void *data;
@@ -84,8 +171,7 @@ struct atom_s {
 			size_t fp_index;
 			uint32_t ip_index;
 			uint16_t arg_count;
-			uint8_t padding;
-			uint8_t scope_escaped;
+			uint16_t padding;
 			scope_p frame_scope;
 		} interpreter_state;
 	};
@@ -94,6 +180,9 @@ struct atom_s {
 typedef struct {
 	char *key;
 	atom_t *value;
+	// Incremented each time the value is replaced. Inlined calls check it to see if the lambda
+	// they inlined is still bound, see BC_GUARD_INLINED.
+	uint32_t version;
 } env_binding_t;
 
 struct env_s {
@@ -120,20 +209,42 @@ struct env_s {
 #define T_NIL 3
 #define T_TRUE 4
 #define T_FALSE 5
+#define T_BIGNUM 6
+#define T_FLOAT 7
+#define T_VECTOR 8
+#define T_HASH 9
+#define T_ARRAY 10
+#define T_STR_BUILDER 11
+#define T_FUTURE 12
 
 // Atoms with complex eval behaviour. T_COMPLEX_ATOM is used to distinguish simple from
-// complex atoms, it isn't a type in itself.
-#define T_COMPLEX_ATOM 10
-#define T_SYM 10
-#define T_PAIR 11
-#define T_BUILDIN 12
-#define T_LAMBDA 13
-#define T_COMPILED_LAMBDA 14
-#define T_RUNTIME_LAMBDA 15
-#define T_ENV 16
-#define T_INTERPRETER_STATE 17
-
-#define T_CUSTOM 20
+// complex atoms, it isn't a type in itself. It leaves room for more simple atom types.
+#define T_COMPLEX_ATOM 32
+#define T_SYM 32
+#define T_PAIR 33
+#define T_BUILDIN 34
+#define T_LAMBDA 35
+#define T_COMPILED_LAMBDA 36
+#define T_RUNTIME_LAMBDA 37
+#define T_ENV 38
+#define T_INTERPRETER_STATE 39
+// Holds a local variable captured by a lambda. Never visible on the Lisp level.
+#define T_BOX 40
+// An already evaluated value in the argument list of a buildin, evals to the value in `boxed`.
+// Never visible on the Lisp level, see eval_buildin_args().
+#define T_VALUE 41
+
+#define T_CUSTOM 48
+
+// Element types of T_ARRAY atoms
+#define ARRAY_I64 1
+#define ARRAY_F64 2
+#define ARRAY_U8 3
+
+// Buildins without side effects that always return the same result for the same arguments. The
+// compiler calls them at compile time when all arguments are constants. They have to report
+// errors by warning and returning nil, such calls are left for the runtime.
+#define BUILDIN_PURE	0x01
 
 //
 // Functions
@@ -148,16 +259,29 @@ atom_t* false_atom();
 
 // Atom allocator values that already get the content
 atom_t* num_atom_alloc(int64_t value);
+atom_t* bignum_atom_alloc(bignum_t *value);
+atom_t* float_atom_alloc(double value);
 atom_t* sym_atom_alloc(char *sym);
 atom_t* str_atom_alloc(char *str);
+atom_t* str_slice_atom_alloc(char *str, size_t length);
+atom_t* str_builder_atom_alloc(str_builder_t *builder);
 atom_t* pair_atom_alloc(atom_t *first, atom_t *rest);
+atom_t* vector_atom_alloc(size_t length, atom_t *fill);
+atom_t* hash_atom_alloc(hash_t *hash);
+atom_t* future_atom_alloc();
+atom_t* array_atom_alloc(uint8_t kind, void *data, size_t length);
 atom_t* buildin_atom_alloc(buildin_func_t func, compile_func_t compile_func);
 atom_t* lambda_atom_alloc(atom_t *body, atom_t *args, env_t *env);
 atom_t* compiled_lambda_atom_alloc(bytecode_t bytecode, atom_list_t literal_table, uint16_t arg_count, uint16_t var_count);
 atom_t* runtime_lambda_atom_alloc(atom_t *compiled_lambda, scope_p scopes);
 atom_t* env_atom_alloc(env_t *env);
 atom_t* custom_atom_alloc(uint64_t type, void *data, buildin_func_t func);
-atom_t* interpreter_state_atom_alloc(size_t fp_index, size_t ip_index, size_t arg_count, uint8_t scope_escaped, scope_p frame_scope);
+atom_t* interpreter_state_atom_alloc(size_t fp_index, size_t ip_index, size_t arg_count, scope_p frame_scope);
+atom_t* box_atom_alloc(atom_t *value);
+atom_t* value_atom_alloc(atom_t *value);
+
+// Updates the compiler data that is derived from the bytecode of a compiled lambda
+void compiled_lambda_analyze(atom_t *cl);
 
 // Convinience functions to alloc and initialize scope_t structures
 scope_p scope_stack_alloc(scope_p next, uint16_t arg_count, size_t frame_index);
@@ -167,6 +291,7 @@ scope_p scope_env_alloc(env_t *env);
 // Environement functions
 env_t* env_alloc(env_t *parent);
 atom_t* env_get(env_t *env, char *key);
+ssize_t env_binding_index(env_t *env, char *key);
 void env_def(env_t *env, char *key, atom_t *value);
 void env_set(env_t *env, char *key, atom_t *value);
 
@@ -0,0 +1,229 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <assert.h>
+
+#include "pool.h"
+#include "gc.h"
+
+#define TASK_QUEUED	0
+#define TASK_RUNNING	1
+#define TASK_DONE		2
+
+struct pool_task {
+	pool_func_t func;
+	void *data;
+	int state;
+};
+
+// Ring buffer of tasks. The owner uses the back, other threads steal from the front.
+typedef struct {
+	pthread_mutex_t lock;
+	pool_task_t **tasks;
+	size_t head, length, capacity;
+} deque_t;
+
+typedef struct {
+	size_t worker_count;
+	// One deque per worker and a last one for tasks submitted by other threads
+	deque_t *deques;
+	// Idle workers sleep on `changed`. It's signaled when a task is queued or done, so threads
+	// waiting for a task are woken up as well.
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	size_t queued;
+} pool_t;
+
+// Allocated uncollectable so the collector sees the queued tasks
+static pool_t *pool = NULL;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+// The deque of the current thread, the shared one for threads outside of the pool
+static __thread size_t own_deque = SIZE_MAX;
+
+
+static void deque_push_back(deque_t *deque, pool_task_t *task){
+	pthread_mutex_lock(&deque->lock);
+	if (deque->length == deque->capacity) {
+		size_t capacity = (deque->capacity == 0) ? 64 : deque->capacity * 2;
+		pool_task_t **tasks = gc_alloc_uncollectable(capacity * sizeof(pool_task_t*));
+		for(size_t i = 0; i < deque->length; i++)
+			tasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+		if (deque->tasks != NULL)
+			gc_free(deque->tasks);
+		deque->tasks = tasks;
+		deque->head = 0;
+		deque->capacity = capacity;
+	}
+	
+	deque->tasks[(deque->head + deque->length) % deque->capacity] = task;
+	deque->length++;
+	pthread_mutex_unlock(&deque->lock);
+}
+
+// Both pops return NULL if the deque is empty. Taken slots are cleared so the collector doesn't
+// keep finished tasks alive.
+static pool_task_t* deque_pop_back(deque_t *deque){
+	pool_task_t *task = NULL;
+	pthread_mutex_lock(&deque->lock);
+	if (deque->length > 0) {
+		deque->length--;
+		size_t index = (deque->head + deque->length) % deque->capacity;
+		task = deque->tasks[index];
+		deque->tasks[index] = NULL;
+	}
+	pthread_mutex_unlock(&deque->lock);
+	return task;
+}
+
+static pool_task_t* deque_pop_front(deque_t *deque){
+	pool_task_t *task = NULL;
+	pthread_mutex_lock(&deque->lock);
+	if (deque->length > 0) {
+		task = deque->tasks[deque->head];
+		deque->tasks[deque->head] = NULL;
+		deque->head = (deque->head + 1) % deque->capacity;
+		deque->length--;
+	}
+	pthread_mutex_unlock(&deque->lock);
+	return task;
+}
+
+
+/**
+ * Takes a task from the back of the own deque or steals one from the front of another deque.
+ * Returns NULL if there is no queued task.
+ */
+static pool_task_t* take_task(size_t own){
+	size_t deque_count = pool->worker_count + 1;
+	pool_task_t *task = deque_pop_back(&pool->deques[own]);
+	for(size_t i = 1; task == NULL && i < deque_count; i++)
+		task = deque_pop_front(&pool->deques[(own + i) % deque_count]);
+	
+	if (task != NULL) {
+		pthread_mutex_lock(&pool->lock);
+		pool->queued--;
+		pthread_mutex_unlock(&pool->lock);
+	}
+	return task;
+}
+
+static void run_task(pool_task_t *task){
+	__atomic_store_n(&task->state, TASK_RUNNING, __ATOMIC_RELAXED);
+	task->func(task->data);
+	// Release makes everything the task wrote visible to threads that see it as done
+	__atomic_store_n(&task->state, TASK_DONE, __ATOMIC_RELEASE);
+	
+	pthread_mutex_lock(&pool->lock);
+	pthread_cond_broadcast(&pool->changed);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+static void* worker_main(void *arg){
+	own_deque = (size_t)arg;
+	
+	while (true) {
+		pool_task_t *task = take_task(own_deque);
+		if (task != NULL) {
+			run_task(task);
+			continue;
+		}
+		
+		pthread_mutex_lock(&pool->lock);
+		while (pool->queued == 0)
+			pthread_cond_wait(&pool->changed, &pool->lock);
+		pthread_mutex_unlock(&pool->lock);
+	}
+	
+	return NULL;
+}
+
+// The LISP_WORKERS environment variable overrides the number of workers
+static void pool_start(){
+	long worker_count = sysconf(_SC_NPROCESSORS_ONLN);
+	char *workers_env = getenv("LISP_WORKERS");
+	if (workers_env != NULL)
+		worker_count = atol(workers_env);
+	
+	pool = gc_alloc_uncollectable(sizeof(pool_t));
+	pool->worker_count = (worker_count > 0) ? worker_count : 1;
+	pool->deques = gc_alloc_uncollectable((pool->worker_count + 1) * sizeof(deque_t));
+	for(size_t i = 0; i < pool->worker_count + 1; i++){
+		pthread_mutex_init(&pool->deques[i].lock, NULL);
+		pool->deques[i].tasks = NULL;
+		pool->deques[i].head = pool->deques[i].length = pool->deques[i].capacity = 0;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->changed, NULL);
+	pool->queued = 0;
+	
+	for(size_t i = 0; i < pool->worker_count; i++){
+		pthread_t thread;
+		int error = gc_thread_create(&thread, worker_main, (void*)i);
+		assert(error == 0);
+		pthread_detach(thread);
+	}
+}
+
+static size_t current_deque(){
+	pthread_once(&pool_once, pool_start);
+	return (own_deque == SIZE_MAX) ? pool->worker_count : own_deque;
+}
+
+
+/**
+ * Queues `func` to be called with `data` by a worker. Workers push the task onto their own
+ * deque so it's likely run by the same worker (and while its data is still in the cache).
+ */
+pool_task_t* pool_submit(pool_func_t func, void *data){
+	size_t own = current_deque();
+	
+	pool_task_t *task = gc_alloc(sizeof(pool_task_t));
+	task->func = func;
+	task->data = data;
+	task->state = TASK_QUEUED;
+	
+	// Count the task before it's pushed. Otherwise a worker could take it and decrement `queued`
+	// before it was incremented.
+	pthread_mutex_lock(&pool->lock);
+	pool->queued++;
+	pthread_mutex_unlock(&pool->lock);
+	
+	deque_push_back(&pool->deques[own], task);
+	
+	pthread_mutex_lock(&pool->lock);
+	pthread_cond_broadcast(&pool->changed);
+	pthread_mutex_unlock(&pool->lock);
+	
+	return task;
+}
+
+bool pool_task_done(pool_task_t *task){
+	return __atomic_load_n(&task->state, __ATOMIC_ACQUIRE) == TASK_DONE;
+}
+
+/**
+ * Waits until `task` is done. Runs other queued tasks (including `task` itself) while waiting.
+ */
+void pool_wait(pool_task_t *task){
+	size_t own = current_deque();
+	
+	while ( !pool_task_done(task) ) {
+		pool_task_t *other = take_task(own);
+		if (other != NULL) {
+			run_task(other);
+			continue;
+		}
+		
+		pthread_mutex_lock(&pool->lock);
+		while ( !pool_task_done(task) && pool->queued == 0 )
+			pthread_cond_wait(&pool->changed, &pool->lock);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+size_t pool_worker_count(){
+	current_deque();
+	return pool->worker_count;
+}
\ No newline at end of file
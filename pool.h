@@ -0,0 +1,28 @@
+#ifndef _POOL_H
+#define _POOL_H
+
+/**
+ * Work stealing thread pool. Each worker has its own deque of tasks: it takes new tasks from the
+ * back of its own deque and steals from the front of the other deques when it runs out of work.
+ * Tasks submitted by threads outside of the pool go into a shared deque the workers steal from.
+ *
+ * A thread waiting for a task runs other queued tasks in the meantime. So tasks can submit and
+ * wait for more tasks without blocking a worker.
+ *
+ * The workers are started on first use, one per CPU core unless the LISP_WORKERS environment
+ * variable says otherwise. They're created by the collector (see
+ * gc_thread_create()) and each one uses its own bytecode interpreter and allocation pools.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef void (*pool_func_t)(void *data);
+typedef struct pool_task pool_task_t;
+
+pool_task_t* pool_submit(pool_func_t func, void *data);
+void pool_wait(pool_task_t *task);
+bool pool_task_done(pool_task_t *task);
+size_t pool_worker_count();
+
+#endif
\ No newline at end of file
@@ -1,7 +1,11 @@
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "printer.h"
+#include "bignum.h"
+#include "hash.h"
+#include "str.h"
 
 void print_list(output_stream_t *stream, atom_t *list_atom);
 
@@ -10,11 +14,19 @@ void print_atom(output_stream_t *stream, atom_t *atom){
 		case T_NUM:
 			os_printf(stream, "%ld", atom->num);
 			break;
+		case T_BIGNUM:
+			os_printf(stream, "%s", bignum_to_str(atom->bignum));
+			break;
+		case T_FLOAT: {
+			char buffer[32];
+			format_float(buffer, sizeof(buffer), atom->real);
+			os_printf(stream, "%s", buffer);
+			} break;
 		case T_SYM:
 			os_printf(stream, "%s", atom->sym);
 			break;
 		case T_STR:
-			os_printf(stream, "\"%s\"", atom->str);
+			os_printf(stream, "\"%.*s\"", (int)atom->str_length, atom->str);
 			break;
 		case T_NIL:
 			os_printf(stream, "nil");
@@ -33,6 +45,42 @@ void print_atom(output_stream_t *stream, atom_t *atom){
 				print_list(stream, atom);
 			}
 			break;
+		case T_VECTOR:
+			os_printf(stream, "#(");
+			for(size_t i = 0; i < atom->length; i++){
+				if (i > 0)
+					os_printf(stream, " ");
+				print_atom(stream, atom->elements[i]);
+			}
+			os_printf(stream, ")");
+			break;
+		case T_ARRAY: {
+			static const char *kind_names[] = { [ARRAY_I64] = "i64", [ARRAY_F64] = "f64", [ARRAY_U8] = "u8" };
+			os_printf(stream, "#%s(", kind_names[atom->array.kind]);
+			for(size_t i = 0; i < atom->array.length; i++){
+				if (i > 0)
+					os_printf(stream, " ");
+				if (atom->array.kind == ARRAY_I64) {
+					os_printf(stream, "%ld", ((int64_t*)atom->array.data)[i]);
+				} else if (atom->array.kind == ARRAY_F64) {
+					char buffer[32];
+					format_float(buffer, sizeof(buffer), ((double*)atom->array.data)[i]);
+					os_printf(stream, "%s", buffer);
+				} else {
+					os_printf(stream, "%u", ((uint8_t*)atom->array.data)[i]);
+				}
+			}
+			os_printf(stream, ")");
+			} break;
+		case T_STR_BUILDER:
+			os_printf(stream, "string builder with %zu bytes", atom->builder->length);
+			break;
+		case T_FUTURE:
+			os_printf(stream, "future %p", atom);
+			break;
+		case T_HASH:
+			os_printf(stream, "hash with %zu entries", atom->hash->length);
+			break;
 		case T_BUILDIN:
 			os_printf(stream, "buildin at %p", atom->func);
 			break;
@@ -79,4 +127,17 @@ void print_list(output_stream_t *stream, atom_t *list_atom){
 	}
 	
 	os_printf(stream, ")");
+}
+
+/**
+ * Writes the shortest representation of `value` that is read back as the same double. Integral
+ * values get a ".0" so the reader doesn't turn them into integers.
+ */
+void format_float(char *buffer, size_t size, double value){
+	snprintf(buffer, size, "%.15g", value);
+	if (strtod(buffer, NULL) != value)
+		snprintf(buffer, size, "%.17g", value);
+	// Skip exponents, inf and nan
+	if ( strpbrk(buffer, ".en") == NULL )
+		strncat(buffer, ".0", size - strlen(buffer) - 1);
 }
\ No newline at end of file
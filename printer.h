@@ -5,5 +5,6 @@
 #include "memory.h"
 
 void print_atom(output_stream_t *stream, atom_t *atom);
+void format_float(char *buffer, size_t size, double value);
 
 #endif
\ No newline at end of file
@@ -4,12 +4,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
 
 #include "reader.h"
 #include "logger.h"
+#include "bignum.h"
 
 atom_t* read_sym(scanner_t *scan);
 atom_t* read_list(scanner_t *scan);
+atom_t* read_num(scanner_t *scan);
 
 atom_t* read_atom(scanner_t *scan){
 	slice_t slice;
@@ -29,22 +32,63 @@ atom_t* read_atom(scanner_t *scan){
 		scan_one_of(scan, '\'');
 		atom_t *content = read_atom(scan);
 		return pair_atom_alloc(sym_atom_alloc("quote"), pair_atom_alloc(content, nil_atom()));
+	} else if (c == '#') {
+		// Vector, the elements are not evaluated (like a quoted list)
+		scan_one_of(scan, '#');
+		atom_t *list = read_list(scan);
+		size_t length = 0;
+		for(atom_t *pair = list; pair->type == T_PAIR; pair = pair->rest)
+			length++;
+		
+		atom_t *vector = vector_atom_alloc(length, nil_atom());
+		atom_t *pair = list;
+		for(size_t i = 0; i < length; i++, pair = pair->rest)
+			vector->elements[i] = pair->first;
+		return vector;
 	} else if (c == '"') {
 		// String
 		scan_one_of(scan, '"');
 		scan_until(scan, &slice, '"');
-		return str_atom_alloc(slice.ptr);
+		return str_slice_atom_alloc(slice.ptr, slice.length);
 	} else if ( isdigit(c) ) {
-		// Number
-		scan_while_func(scan, &slice, isdigit);
-		int64_t value = strtoll(slice.ptr, NULL, 10);
-		free(slice.ptr);
-		return num_atom_alloc(value);
+		return read_num(scan);
 	} else {
 		return read_sym(scan);
 	}
 }
 
+static int is_float_char(int c){
+	return (c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-');
+}
+
+/**
+ * Reads an integer or float. Integers that don't fit into an int64_t are read as bignums.
+ * Numbers with a decimal point or exponent are floats.
+ */
+atom_t* read_num(scanner_t *scan){
+	slice_t slice;
+	scan_while_func(scan, &slice, isdigit, is_float_char);
+	
+	atom_t *atom;
+	char *end = NULL;
+	if ( strpbrk(slice.ptr, ".eE") != NULL ) {
+		double value = strtod(slice.ptr, &end);
+		atom = float_atom_alloc(value);
+	} else {
+		errno = 0;
+		int64_t value = strtoll(slice.ptr, &end, 10);
+		atom = (errno == ERANGE) ? bignum_atom_alloc(bignum_from_str(slice.ptr)) : num_atom_alloc(value);
+	}
+	
+	if (*end != '\0') {
+		warn("invalid number: %s", slice.ptr);
+		atom = nil_atom();
+	}
+	
+	free(slice.ptr);
+	return atom;
+}
+
 atom_t* read_list(scanner_t *scan){
 	int c;
 	atom_t* list_start_atom = pair_atom_alloc( nil_atom(), nil_atom() );
@@ -0,0 +1,62 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "sort.h"
+
+// Runs of this length are sorted with insertion sort before merging
+#define SORT_RUN_LENGTH 32
+
+static void insertion_sort(atom_t **atoms, size_t length, sort_less_t less, void *data){
+	for(size_t i = 1; i < length; i++){
+		atom_t *atom = atoms[i];
+		size_t j = i;
+		for(; j > 0 && less(atom, atoms[j-1], data); j--)
+			atoms[j] = atoms[j-1];
+		atoms[j] = atom;
+	}
+}
+
+/**
+ * Merges the sorted runs `left` and `right` into `target`. Equal elements are taken from the left
+ * run first to keep the sort stable.
+ */
+static void merge(atom_t **target, atom_t **left, size_t left_length, atom_t **right, size_t right_length, sort_less_t less, void *data){
+	// Runs that are already in order are just copied
+	if ( left_length == 0 || right_length == 0 || !less(right[0], left[left_length-1], data) ) {
+		memcpy(target, left, left_length * sizeof(atom_t*));
+		memcpy(target + left_length, right, right_length * sizeof(atom_t*));
+		return;
+	}
+	
+	size_t l = 0, r = 0;
+	while (l < left_length && r < right_length)
+		*target++ = less(right[r], left[l], data) ? right[r++] : left[l++];
+	memcpy(target, left + l, (left_length - l) * sizeof(atom_t*));
+	memcpy(target + (left_length - l), right + r, (right_length - r) * sizeof(atom_t*));
+}
+
+void sort_atoms(atom_t **atoms, size_t length, sort_less_t less, void *data){
+	for(size_t start = 0; start < length; start += SORT_RUN_LENGTH)
+		insertion_sort(atoms + start, (length - start < SORT_RUN_LENGTH) ? length - start : SORT_RUN_LENGTH, less, data);
+	if (length <= SORT_RUN_LENGTH)
+		return;
+	
+	// Merge back and forth between the atoms and a buffer, doubling the run length each pass
+	atom_t **buffer = gc_alloc(length * sizeof(atom_t*));
+	atom_t **source = atoms, **target = buffer;
+	for(size_t width = SORT_RUN_LENGTH; width < length; width *= 2){
+		for(size_t start = 0; start < length; start += 2 * width){
+			size_t middle = (start + width < length) ? start + width : length;
+			size_t end = (start + 2 * width < length) ? start + 2 * width : length;
+			merge(target + start, source + start, middle - start, source + middle, end - middle, less, data);
+		}
+		
+		atom_t **swap = source;
+		source = target;
+		target = swap;
+	}
+	
+	if (source != atoms)
+		memcpy(atoms, source, length * sizeof(atom_t*));
+	gc_free(buffer);
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+#ifndef _SORT_H
+#define _SORT_H
+
+/**
+ * Stable sort for arrays of atoms. Short runs are sorted with insertion sort and then merged
+ * bottom up. Runs that are already in order aren't merged, so sorted input takes linear time.
+ */
+
+#include <stdbool.h>
+#include "memory.h"
+
+// Returns true if `a` has to be sorted before `b`
+typedef bool (*sort_less_t)(atom_t *a, atom_t *b, void *data);
+
+void sort_atoms(atom_t **atoms, size_t length, sort_less_t less, void *data);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "str.h"
+
+/**
+ * Returns the characters from `start` up to (but not including) `end` without copying them.
+ */
+atom_t* str_slice(atom_t *str, size_t start, size_t end){
+	assert(str->type == T_STR && start <= end && end <= str->str_length);
+	return str_slice_atom_alloc(str->str + start, end - start);
+}
+
+bool str_equal(atom_t *a, atom_t *b){
+	return a->str_length == b->str_length && memcmp(a->str, b->str, a->str_length) == 0;
+}
+
+/**
+ * Returns a 0 terminated version of the string. Only slices in the middle of a buffer are copied.
+ */
+char* str_to_cstr(atom_t *str){
+	if (str->str[str->str_length] == '\0')
+		return str->str;
+	
+	char *cstr = gc_alloc_atomic(str->str_length + 1);
+	memcpy(cstr, str->str, str->str_length);
+	cstr[str->str_length] = '\0';
+	return cstr;
+}
+
+
+//
+// String builders
+//
+
+str_builder_t* str_builder_new(size_t capacity){
+	str_builder_t *builder = gc_alloc(sizeof(str_builder_t));
+	builder->data = gc_alloc_atomic(capacity + 1);
+	builder->data[0] = '\0';
+	builder->length = 0;
+	builder->capacity = capacity;
+	return builder;
+}
+
+void str_builder_append(str_builder_t *builder, const char *data, size_t length){
+	if (builder->length + length > builder->capacity) {
+		size_t capacity = (builder->capacity > 0) ? builder->capacity * 2 : 16;
+		while (capacity < builder->length + length)
+			capacity *= 2;
+		
+		// Strings returned by str_builder_to_str() may still point into the old buffer so it's
+		// left to the garbage collector
+		char *new_data = gc_alloc_atomic(capacity + 1);
+		memcpy(new_data, builder->data, builder->length);
+		builder->data = new_data;
+		builder->capacity = capacity;
+	}
+	
+	memcpy(builder->data + builder->length, data, length);
+	builder->length += length;
+	builder->data[builder->length] = '\0';
+}
+
+/**
+ * Returns the current content of the builder as a string. It shares the buffer with the builder.
+ */
+atom_t* str_builder_to_str(str_builder_t *builder){
+	return str_slice_atom_alloc(builder->data, builder->length);
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef _STR_H
+#define _STR_H
+
+/**
+ * Strings (T_STR atoms) carry their length in str_length. Substrings are slices that share the
+ * buffer of the original string, so `str` isn't always 0 terminated. It is always safe to read
+ * the byte after the last character though: it's either the terminating 0 or still part of the
+ * larger buffer. Use str_to_cstr() when a C string is required.
+ *
+ * String builders (T_STR_BUILDER atoms) collect strings in a buffer that grows by doubling.
+ * Appending only writes after the current end so the strings returned by str_builder_to_str()
+ * can share the buffer, too.
+ */
+
+#include <stdbool.h>
+#include "memory.h"
+
+struct str_builder {
+	// Always capacity + 1 bytes, data[length] is 0
+	char *data;
+	size_t length, capacity;
+};
+
+atom_t* str_slice(atom_t *str, size_t start, size_t end);
+bool str_equal(atom_t *a, atom_t *b);
+char* str_to_cstr(atom_t *str);
+
+str_builder_t* str_builder_new(size_t capacity);
+void str_builder_append(str_builder_t *builder, const char *data, size_t length);
+atom_t* str_builder_to_str(str_builder_t *builder);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include <string.h>
+#include "test_utils.h"
+#include "../array.h"
+#include "../bignum.h"
+
+// Fills an array with 0, 1, 2, ... (as f64 for f64 arrays)
+static atom_t* counting_array(uint8_t kind, size_t length){
+	atom_t *array = array_new(kind, length);
+	for(size_t i = 0; i < length; i++)
+		array_set(array, i, (kind == ARRAY_F64) ? float_atom_alloc(i) : num_atom_alloc(i % 256));
+	return array;
+}
+
+void test_get_and_set(){
+	atom_t *array = array_new(ARRAY_I64, 3);
+	test(array->type == T_ARRAY && array->array.length == 3, "expected an array with 3 elements");
+	test(array_get(array, 2)->type == T_NUM && array_get(array, 2)->num == 0, "new arrays should be zeroed");
+	
+	test(array_set(array, 1, num_atom_alloc(-7)) == true, "storing an integer in an i64 array failed");
+	test(array_get(array, 1)->num == -7, "expected -7, got %ld", array_get(array, 1)->num);
+	test(array_set(array, 1, float_atom_alloc(1.5)) == false, "i64 arrays should not take floats");
+	
+	atom_t *floats = array_new(ARRAY_F64, 2);
+	test(array_set(floats, 0, num_atom_alloc(3)) == true, "f64 arrays should take integers");
+	test(array_get(floats, 0)->type == T_FLOAT && array_get(floats, 0)->real == 3.0, "expected 3.0");
+	
+	atom_t *bytes = array_new(ARRAY_U8, 2);
+	test(array_set(bytes, 0, num_atom_alloc(255)) == true, "storing 255 in an u8 array failed");
+	test(array_set(bytes, 1, num_atom_alloc(256)) == false, "u8 arrays should not take 256");
+	test(array_set(bytes, 1, num_atom_alloc(-1)) == false, "u8 arrays should not take -1");
+}
+
+void test_kernels(){
+	// 103 elements so every kernel runs its vector loop and the scalar loop for the rest
+	size_t length = 103;
+	uint8_t kinds[] = { ARRAY_I64, ARRAY_F64, ARRAY_U8 };
+	
+	for(size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++){
+		atom_t *a = counting_array(kinds[k], length);
+		atom_t *sum = array_add(a, a), *product = array_mul(a, a);
+		
+		bool all_correct = true;
+		int64_t expected_dot = 0;
+		for(size_t i = 0; i < length; i++){
+			double element = (kinds[k] == ARRAY_F64) ? array_get(sum, i)->real : array_get(sum, i)->num;
+			if (element != (double)((kinds[k] == ARRAY_U8) ? (2 * i) % 256 : 2 * i))
+				all_correct = false;
+			element = (kinds[k] == ARRAY_F64) ? array_get(product, i)->real : array_get(product, i)->num;
+			if (element != (double)((kinds[k] == ARRAY_U8) ? (i * i) % 256 : i * i))
+				all_correct = false;
+			expected_dot += i * i;
+		}
+		test(all_correct, "wrong elementwise results for array kind %d", kinds[k]);
+		
+		atom_t *total = array_sum(a), *dot = array_dot(a, a);
+		double total_value = (total->type == T_FLOAT) ? total->real : total->num;
+		double dot_value = (dot->type == T_FLOAT) ? dot->real : dot->num;
+		test(total_value == 102 * 103 / 2, "wrong sum for array kind %d: %f", kinds[k], total_value);
+		test(dot_value == expected_dot, "wrong dot product for array kind %d: %f", kinds[k], dot_value);
+	}
+}
+
+void test_exact_i64_sum_and_dot(){
+	atom_t *a = array_new(ARRAY_I64, 5);
+	for(size_t i = 0; i < 3; i++)
+		array_set(a, i, num_atom_alloc(INT64_MAX));
+	atom_t *total = array_sum(a);
+	test(total->type == T_BIGNUM, "the sum should have been promoted to a bignum");
+	test(strcmp(bignum_to_str(total->bignum), "27670116110564327421") == 0, "expected 27670116110564327421, got %s", bignum_to_str(total->bignum));
+	
+	array_set(a, 2, num_atom_alloc(-INT64_MAX));
+	total = array_sum(a);
+	test(total->type == T_NUM && total->num == INT64_MAX, "expected INT64_MAX after an intermediate overflow");
+	
+	atom_t *b = array_new(ARRAY_I64, 10);
+	for(size_t i = 0; i < 10; i++)
+		array_set(b, i, num_atom_alloc((int64_t)1 << 62));
+	atom_t *dot = array_dot(b, b);
+	test(dot->type == T_BIGNUM, "the dot product should have been promoted to a bignum");
+	test(strcmp(bignum_to_str(dot->bignum), "212676479325586539664609129644855132160") == 0, "expected 212676479325586539664609129644855132160, got %s", bignum_to_str(dot->bignum));
+	
+	atom_t *small = counting_array(ARRAY_I64, 10);
+	array_set(small, 9, num_atom_alloc(-3));
+	dot = array_dot(small, array_new(ARRAY_I64, 10));
+	test(dot->type == T_NUM && dot->num == 0, "expected a dot product of 0 with a zero array");
+	dot = array_dot(small, small);
+	test(dot->type == T_NUM && dot->num == 213, "expected 213, got %ld", dot->num);
+}
+
+void test_min_max_and_filter(){
+	atom_t *a = counting_array(ARRAY_I64, 50);
+	array_set(a, 37, num_atom_alloc(-5));
+	array_set(a, 3, num_atom_alloc(1000));
+	test(array_min(a)->num == -5, "expected a minimum of -5, got %ld", array_min(a)->num);
+	test(array_max(a)->num == 1000, "expected a maximum of 1000, got %ld", array_max(a)->num);
+	test(array_min(array_new(ARRAY_F64, 0))->type == T_NIL, "the minimum of an empty array should be nil");
+	
+	atom_t *large = array_filter(a, BC_GT, num_atom_alloc(45));
+	test(large->array.length == 5, "expected 5 elements greater than 45, got %zu", large->array.length);
+	test(array_get(large, 0)->num == 1000 && array_get(large, 4)->num == 49, "filter should keep the order of the elements");
+	
+	atom_t *floats = counting_array(ARRAY_F64, 10);
+	atom_t *small = array_filter(floats, BC_LT, float_atom_alloc(2.5));
+	test(small->array.length == 3, "expected 3 elements below 2.5, got %zu", small->array.length);
+	test(array_filter(a, BC_EQ, float_atom_alloc(1.0)) == NULL, "i64 arrays can only be filtered with integers");
+}
+
+
+int main(){
+	memory_init();
+	
+	test_get_and_set();
+	test_kernels();
+	test_exact_i64_sum_and_dot();
+	test_min_max_and_filter();
+	
+	return show_test_report();
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include <string.h>
+#include <stdlib.h>
+
+#include "test_utils.h"
+#include "../bignum.h"
+
+void test_conversion(){
+	char *samples[] = {
+		"0",
+		"1",
+		"-1",
+		"4294967296",
+		"-9223372036854775808",
+		"18446744073709551616",
+		"1000000000000000000000000000000",
+		"-123456789012345678901234567890123456789",
+		NULL
+	};
+	
+	for(size_t i = 0; samples[i] != NULL; i++){
+		char *str = bignum_to_str(bignum_from_str(samples[i]));
+		test(strcmp(str, samples[i]) == 0, "conversion from and to a string failed, expected %s, got %s", samples[i], str);
+	}
+	
+	int64_t value = 0;
+	test( bignum_to_int(bignum_from_int(INT64_MIN), &value) && value == INT64_MIN, "INT64_MIN should fit into an int64_t");
+	test( bignum_to_int(bignum_from_int(INT64_MAX), &value) && value == INT64_MAX, "INT64_MAX should fit into an int64_t");
+	test( !bignum_to_int(bignum_from_str("9223372036854775808"), &value), "INT64_MAX + 1 should not fit into an int64_t");
+	test( !bignum_to_int(bignum_from_str("-9223372036854775809"), &value), "INT64_MIN - 1 should not fit into an int64_t");
+}
+
+void test_arithmetic(){
+	struct { char *a, op, *b, *result; } samples[] = {
+		{ "18446744073709551615", '+', "1", "18446744073709551616" },
+		{ "-18446744073709551616", '+', "1", "-18446744073709551615" },
+		{ "5", '+', "-18446744073709551616", "-18446744073709551611" },
+		{ "18446744073709551616", '-', "18446744073709551616", "0" },
+		{ "1", '-', "18446744073709551616", "-18446744073709551615" },
+		{ "4294967296", '*', "-4294967296", "-18446744073709551616" },
+		{ "123456789012345678901234567890", '*', "987654321098765432109876543210", "121932631137021795226185032733622923332237463801111263526900" },
+		{ "121932631137021795226185032733622923332237463801111263526900", '/', "987654321098765432109876543210", "123456789012345678901234567890" },
+		{ "-18446744073709551617", '/', "4294967296", "-4294967296" },
+		{ "-18446744073709551617", '%', "4294967296", "-1" },
+		{ "100000000000000000000000000000", '%', "99999999999999999999", "1000000000" },
+		{ NULL, 0, NULL, NULL }
+	};
+	
+	for(size_t i = 0; samples[i].a != NULL; i++){
+		bignum_t *a = bignum_from_str(samples[i].a), *b = bignum_from_str(samples[i].b), *result = NULL;
+		switch(samples[i].op){
+			case '+': result = bignum_add(a, b); break;
+			case '-': result = bignum_sub(a, b); break;
+			case '*': result = bignum_mul(a, b); break;
+			case '/': result = bignum_div(a, b, NULL); break;
+			case '%': bignum_div(a, b, &result); break;
+		}
+		
+		char *str = bignum_to_str(result);
+		test(strcmp(str, samples[i].result) == 0, "%s %c %s should be %s, got %s", samples[i].a, samples[i].op, samples[i].b, samples[i].result, str);
+	}
+}
+
+void test_karatsuba(){
+	// (10^n - 1)^2 = 10^2n - 2 * 10^n + 1 is n-1 nines, an eight, n-1 zeros and a one. With 1000 decimal
+	// digits both operands have over 100 digits and are multiplied with Karatsuba.
+	size_t n = 1000;
+	char *nines = calloc(n + 1, 1), *expected = calloc(2*n + 1, 1);
+	memset(nines, '9', n);
+	memset(expected, '9', n - 1);
+	expected[n-1] = '8';
+	memset(expected + n, '0', n - 1);
+	expected[2*n-1] = '1';
+	
+	bignum_t *a = bignum_from_str(nines);
+	char *str = bignum_to_str(bignum_mul(a, a));
+	test(strcmp(str, expected) == 0, "squaring 10^%zu - 1 failed", n);
+	
+	// Unbalanced and odd sized operands, checked by dividing the product again
+	bignum_t *b = bignum_from_str("98765432109876543210987654321098765432109876543210987654321098765432109876543210");
+	bignum_t *factor = bignum_add(bignum_mul(a, a), b), *remainder = NULL;
+	bignum_t *quotient = bignum_div(bignum_mul(a, factor), a, &remainder);
+	test(bignum_cmp(quotient, factor) == 0 && remainder->length == 0, "division of a Karatsuba product didn't give the original factor");
+	
+	free(nines);
+	free(expected);
+}
+
+void test_num_atoms(){
+	atom_t *max = num_atom_alloc(INT64_MAX), *one = num_atom_alloc(1);
+	
+	atom_t *sum = num_add(max, one);
+	test(sum->type == T_BIGNUM, "INT64_MAX + 1 should overflow into a bignum");
+	test(strcmp(bignum_to_str(sum->bignum), "9223372036854775808") == 0, "INT64_MAX + 1 has the wrong value");
+	
+	atom_t *back = num_sub(sum, one);
+	test(back->type == T_NUM && back->num == INT64_MAX, "results that fit into an int64_t should be numbers again");
+	
+	atom_t *product = num_mul(num_atom_alloc(3), num_atom_alloc(4));
+	test(product->type == T_NUM && product->num == 12, "small products should stay numbers");
+	
+	atom_t *quotient = num_div(num_atom_alloc(INT64_MIN), num_atom_alloc(-1));
+	test(quotient->type == T_BIGNUM, "INT64_MIN / -1 should overflow into a bignum");
+	
+	test(num_cmp(sum, max) > 0, "bignum should compare greater than INT64_MAX");
+	test(num_cmp(num_atom_alloc(INT64_MIN), num_sub(num_atom_alloc(INT64_MIN), one)) > 0, "INT64_MIN should compare greater than INT64_MIN - 1");
+}
+
+
+int main(){
+	memory_init();
+	
+	test_conversion();
+	test_arithmetic();
+	test_karatsuba();
+	test_num_atoms();
+	
+	return show_test_report();
+}
\ No newline at end of file
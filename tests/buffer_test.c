@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test_utils.h"
+#include "../buffer.h"
+#include "../array.h"
+
+void test_files(){
+	char path[] = "/tmp/buffer_test_XXXXXX";
+	int fd = mkstemp(path);
+	close(fd);
+	
+	test(buffer_write_file(path, "hello", 5, false), "writing the file failed");
+	test(buffer_write_file(path, " world", 6, true), "appending to the file failed");
+	
+	// Regular files are mapped, writes to the buffer must not change the file
+	atom_t *buffer = buffer_read_file(path);
+	test(buffer != NULL && buffer->type == T_ARRAY && buffer->array.kind == ARRAY_U8, "reading the file failed");
+	test(buffer->array.length == 11 && memcmp(buffer->array.data, "hello world", 11) == 0, "wrong file content");
+	((uint8_t*)buffer->array.data)[0] = 'j';
+	atom_t *again = buffer_read_file(path);
+	test(((uint8_t*)again->array.data)[0] == 'h', "changing the buffer changed the file");
+	
+	// Empty files can't be mapped
+	test(buffer_write_file(path, "", 0, false), "truncating the file failed");
+	atom_t *empty = buffer_read_file(path);
+	test(empty != NULL && empty->array.length == 0, "expected an empty buffer");
+	
+	unlink(path);
+	test(buffer_read_file(path) == NULL, "reading a missing file should fail");
+	
+	// Pipes are read in chunks
+	FILE *pipe = popen("head -c 200000 /dev/zero", "r");
+	char pipe_path[64];
+	snprintf(pipe_path, sizeof(pipe_path), "/dev/fd/%d", fileno(pipe));
+	atom_t *piped = buffer_read_file(pipe_path);
+	test(piped != NULL && piped->array.length == 200000, "expected 200000 bytes from the pipe");
+	pclose(pipe);
+}
+
+void test_ints(){
+	atom_t *buffer = array_new(ARRAY_U8, 16);
+	buffer_int_t u16be, i32le, i8, i64le;
+	test(buffer_parse_int_type("u16be", &u16be) && u16be.size == 2 && u16be.big_endian, "failed to parse u16be");
+	test(buffer_parse_int_type("i32le", &i32le) && i32le.size == 4 && i32le.is_signed, "failed to parse i32le");
+	test(buffer_parse_int_type("i8", &i8) && buffer_parse_int_type("i64le", &i64le), "failed to parse i8 and i64le");
+	buffer_int_t unused;
+	test(!buffer_parse_int_type("u16", &unused) && !buffer_parse_int_type("u64le", &unused) && !buffer_parse_int_type("x8", &unused), "invalid types should not parse");
+	
+	buffer_set_int(buffer, 0, u16be, 0x1234);
+	uint8_t *bytes = buffer->array.data;
+	test(bytes[0] == 0x12 && bytes[1] == 0x34, "u16be should store the high byte first");
+	test(buffer_get_int(buffer, 0, u16be) == 0x1234, "u16be round trip failed");
+	
+	buffer_set_int(buffer, 4, i32le, -2);
+	test(bytes[4] == 0xfe && bytes[7] == 0xff, "i32le should store the low byte first");
+	test(buffer_get_int(buffer, 4, i32le) == -2, "expected -2, got %ld", buffer_get_int(buffer, 4, i32le));
+	test(buffer_get_int(buffer, 4, i8) == -2, "i8 should be sign extended");
+	
+	buffer_set_int(buffer, 8, i64le, INT64_MIN + 1);
+	test(buffer_get_int(buffer, 8, i64le) == INT64_MIN + 1, "i64le round trip failed");
+}
+
+
+int main(){
+	memory_init();
+	
+	test_files();
+	test_ints();
+	
+	return show_test_report();
+}
\ No newline at end of file
@@ -33,7 +33,7 @@ atom_t *test_sample(char *body, instruction_t *expected_bytecode){
 	test(runtime_lambda->type == T_RUNTIME_LAMBDA, "sample: %s, expected a runtime lambda atom, got type %d",
 		body, runtime_lambda->type);
 	
-	test_instructions(&runtime_lambda->cl->bytecode, expected_bytecode, body);
+	test_instructions(&runtime_lambda->cl->comp_data->bytecode, expected_bytecode, body);
 	
 	return runtime_lambda;
 }
@@ -65,7 +65,7 @@ void test_self_evaling_atoms(){
 		(instruction_t){BC_RETURN},
 		(instruction_t){BC_NULL}
 	});
-	test_atom(atom->cl->literal_table.atoms[0], (atom_t){T_STR, .str = "foo"}, 0, "(lambda () \"foo\")");
+	test_atom(atom->cl->comp_data->literal_table.atoms[0], (atom_t){T_STR, .str = "foo"}, 0, "(lambda () \"foo\")");
 }
 
 void test_nums_in_literal_tables(){
@@ -76,7 +76,7 @@ void test_nums_in_literal_tables(){
 		(instruction_t){BC_RETURN},
 		(instruction_t){BC_NULL}
 	});
-	test_atom(atom->cl->literal_table.atoms[0], (atom_t){T_NUM, .num = 65546}, 0, "number atom was not correctly stored in the literal table");
+	test_atom(atom->cl->comp_data->literal_table.atoms[0], (atom_t){T_NUM, .num = 65546}, 0, "number atom was not correctly stored in the literal table");
 }
 
 
@@ -134,8 +134,12 @@ void test_nested_compilation(){
 		)) \
 	)";
 	atom_t *rl = test_sample(code, (instruction_t[]){
+		// prologue: box outer since the nested lambda captures it
+		(instruction_t){BC_LOAD_NIL},
+		(instruction_t){BC_BOX_LOCAL, .offset = 0, .index = 0},
+		(instruction_t){BC_DROP},
 		(instruction_t){BC_LOAD_NUM, .num = 42},
-		(instruction_t){BC_STORE_LOCAL, .offset = 0, .index = 0},
+		(instruction_t){BC_STORE_BOXED_LOCAL, .offset = 0, .index = 0},
 		(instruction_t){BC_DROP},
 		(instruction_t){BC_LOAD_LAMBDA, .offset = 0, .index = 0},
 		(instruction_t){BC_STORE_LOCAL, .offset = 0, .index = 1},
@@ -150,16 +154,16 @@ void test_nested_compilation(){
 	test( strcmp(rl->cl->comp_data->names[3], "outer") == 0, "variable name was not correctly added to the name list");
 	test( strcmp(rl->cl->comp_data->names[4], "foo") == 0, "variable name was not correctly added to the name list");
 	
-	atom_t *child_cl = rl->cl->literal_table.atoms[0];
+	atom_t *child_cl = rl->cl->comp_data->literal_table.atoms[0];
 	test( child_cl != NULL, "no child lambda was compiled!");
 	test( child_cl->type == T_COMPILED_LAMBDA, "expected compiled lambda (type %d) got type %d", T_COMPILED_LAMBDA, child_cl->type);
-	test_instructions(&child_cl->bytecode, (instruction_t[]){
+	test_instructions(&child_cl->comp_data->bytecode, (instruction_t[]){
 		(instruction_t){BC_LOAD_NUM, .num = 17},
 		(instruction_t){BC_STORE_LOCAL, .offset = 0, .index = 0},
 		(instruction_t){BC_DROP},
-		(instruction_t){BC_LOAD_ARG, .offset = 1, .index = 1},
+		(instruction_t){BC_LOAD_CAPTURED, .offset = 0, .index = 0},
 		(instruction_t){BC_DROP},
-		(instruction_t){BC_LOAD_LOCAL, .offset = 1, .index = 0},
+		(instruction_t){BC_LOAD_BOXED_CAPTURED, .offset = 0, .index = 1},
 		(instruction_t){BC_DROP},
 		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 2},
 		(instruction_t){BC_DROP},
@@ -173,6 +177,16 @@ void test_nested_compilation(){
 	test( strcmp(child_cl->comp_data->names[1], "b") == 0, "variable name was not correctly added to the name list");
 	test( strcmp(child_cl->comp_data->names[2], "c") == 0, "variable name was not correctly added to the name list");
 	test( strcmp(child_cl->comp_data->names[3], "inner") == 0, "variable name was not correctly added to the name list");
+	
+	test( child_cl->comp_data->capture_count == 2, "expected 2 captured variables, got %zu", child_cl->comp_data->capture_count);
+	test( strcmp(child_cl->comp_data->captures[0].name, "y") == 0 && child_cl->comp_data->captures[0].source == CAPTURE_ARG
+		&& child_cl->comp_data->captures[0].index == 1 && !child_cl->comp_data->captures[0].boxed, "y should be captured by value from arg 1");
+	test( strcmp(child_cl->comp_data->captures[1].name, "outer") == 0 && child_cl->comp_data->captures[1].source == CAPTURE_LOCAL
+		&& child_cl->comp_data->captures[1].index == 0 && child_cl->comp_data->captures[1].boxed, "outer should be captured boxed from local 0");
+	test( rl->cl->comp_data->boxed_count == 1 && rl->cl->comp_data->boxed_locals[0] == 0, "outer should be boxed in the parent");
+	
+	test( child_cl->comp_data->max_frame_offset == 0, "the nested lambda only uses its own frame and its captures");
+	test( rl->cl->comp_data->max_frame_offset == 0, "the outer lambda only uses its own frame");
 }
 
 void test_env_lookup_on_unknown_vars(){
@@ -181,7 +195,7 @@ void test_env_lookup_on_unknown_vars(){
 		(instruction_t){BC_RETURN},
 		(instruction_t){BC_NULL}
 	});
-	test_atom(rl->cl->literal_table.atoms[0], (atom_t){T_SYM, .str = "foo"}, 0, "(lambda () foo)");
+	test_atom(rl->cl->comp_data->literal_table.atoms[0], (atom_t){T_SYM, .str = "foo"}, 0, "(lambda () foo)");
 	
 	rl = test_sample("(lambda (n) (if (= n 1) 1 (* n (fac (- n 1))) ))", (instruction_t[]){
 		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
@@ -204,7 +218,8 @@ void test_env_lookup_on_unknown_vars(){
 		(instruction_t){BC_RETURN},
 		(instruction_t){BC_NULL}
 	});
-	test_atom(rl->cl->literal_table.atoms[0], (atom_t){T_SYM, .str = "fac"}, 0, "fac lambda");
+	test_atom(rl->cl->comp_data->literal_table.atoms[0], (atom_t){T_SYM, .str = "fac"}, 0, "fac lambda");
+	test(rl->cl->comp_data->max_stack_depth == 4, "the fac lambda should need 4 stack slots, got %zu", rl->cl->comp_data->max_stack_depth);
 }
 
 void test_self_recursion(){
@@ -220,10 +235,14 @@ void test_self_recursion(){
 		(fac 7) \
 	)";
 	atom_t *rl = test_sample(code, (instruction_t[]){
+		// prologue: box fac since the nested lambda captures it
+		(instruction_t){BC_LOAD_NIL},
+		(instruction_t){BC_BOX_LOCAL, .offset = 0, .index = 0},
+		(instruction_t){BC_DROP},
 		(instruction_t){BC_LOAD_LAMBDA, .offset = 0, .index = 0},
-		(instruction_t){BC_STORE_LOCAL, .offset = 0, .index = 0},
+		(instruction_t){BC_STORE_BOXED_LOCAL, .offset = 0, .index = 0},
 		(instruction_t){BC_DROP}, // from implicit begin
-		(instruction_t){BC_LOAD_LOCAL, .offset = 0, .index = 0},
+		(instruction_t){BC_LOAD_BOXED_LOCAL, .offset = 0, .index = 0},
 		(instruction_t){BC_LOAD_NUM, .num = 7},
 		(instruction_t){BC_CALL, .num = 1},
 		(instruction_t){BC_RETURN},
@@ -233,10 +252,10 @@ void test_self_recursion(){
 	test( rl->cl->comp_data->var_count == 1, "variable count was not updated properly");
 	test( strcmp(rl->cl->comp_data->names[0], "fac") == 0, "variable name was not correctly added to the name list");
 	
-	atom_t *child_cl = rl->cl->literal_table.atoms[0];
+	atom_t *child_cl = rl->cl->comp_data->literal_table.atoms[0];
 	test( child_cl != NULL, "no child lambda was compiled!");
 	test( child_cl->type == T_COMPILED_LAMBDA, "expected compiled lambda (type %d) got type %d", T_COMPILED_LAMBDA, child_cl->type);
-	test_instructions(&child_cl->bytecode, (instruction_t[]){
+	test_instructions(&child_cl->comp_data->bytecode, (instruction_t[]){
 		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
 		(instruction_t){BC_LOAD_NUM, .num = 1},
 		(instruction_t){BC_EQ},
@@ -247,7 +266,7 @@ void test_self_recursion(){
 			// false case
 			// args for *
 				(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
-				(instruction_t){BC_LOAD_LOCAL, .offset = 1, .index = 0},  // look up the fac runtime lambda itself
+				(instruction_t){BC_LOAD_BOXED_CAPTURED, .offset = 0, .index = 0},  // look up the fac runtime lambda itself
 				// args for fac
 					(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
 					(instruction_t){BC_LOAD_NUM, .num = 1},
@@ -270,8 +289,8 @@ void test_quote(){
 }
 
 void test_if(){
-	test_sample("(lambda () (if true 42 17))", (instruction_t[]){
-		(instruction_t){BC_LOAD_TRUE},
+	test_sample("(lambda (cond) (if cond 42 17))", (instruction_t[]){
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
 		(instruction_t){BC_JUMP_IF_FALSE, .jump_offset = 2},
 		(instruction_t){BC_LOAD_NUM, .num = 42},
 		(instruction_t){BC_JUMP, .jump_offset = 1},
@@ -281,12 +300,214 @@ void test_if(){
 	});
 }
 
+void test_constant_folding(){
+	test_sample("(lambda () (* (+ 1 2) (- 10 4)))", (instruction_t[]){
+		(instruction_t){BC_LOAD_NUM, .num = 18},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	});
+	
+	// Only the constant part is folded
+	test_sample("(lambda (x) (+ x (* 2 3)))", (instruction_t[]){
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
+		(instruction_t){BC_LOAD_NUM, .num = 6},
+		(instruction_t){BC_ADD},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	});
+	
+	// Dead branches of ifs with constant conditions are not compiled
+	test_sample("(lambda (x) (if (< 1 2) x 17))", (instruction_t[]){
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	});
+	test_sample("(lambda (x) (if false x (= 1 2)))", (instruction_t[]){
+		(instruction_t){BC_LOAD_FALSE},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	});
+	
+	// Results that don't fit into an instruction go into the literal table
+	atom_t *rl = test_sample("(lambda () (* 1000 1000))", (instruction_t[]){
+		(instruction_t){BC_LOAD_LITERAL, .offset = 0, .index = 0},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	});
+	test_atom(rl->cl->comp_data->literal_table.atoms[0], (atom_t){T_NUM, .num = 1000000}, 0, "(* 1000 1000)");
+}
+
+void test_while(){
+	test_sample("(lambda (n) (while (< 0 n) n))", (instruction_t[]){
+		// condition
+		(instruction_t){BC_LOAD_NUM, .num = 0},
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
+		(instruction_t){BC_LT},
+		(instruction_t){BC_JUMP_IF_FALSE, .jump_offset = 3},
+			// body
+			(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
+			(instruction_t){BC_DROP},
+		(instruction_t){BC_JUMP, .jump_offset = -7},
+		(instruction_t){BC_LOAD_NIL},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	});
+}
+
+void test_let(){
+	atom_t *rl = test_sample("(lambda (x) (let ((x 1) (y x)) y) (let* ((a 2) (b a)) b))", (instruction_t[]){
+		// let: y is bound to the argument x, the new x isn't visible yet
+		(instruction_t){BC_LOAD_NUM, .num = 1},
+		(instruction_t){BC_STORE_LOCAL, .offset = 0, .index = 0},
+		(instruction_t){BC_DROP},
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
+		(instruction_t){BC_STORE_LOCAL, .offset = 0, .index = 1},
+		(instruction_t){BC_DROP},
+		(instruction_t){BC_LOAD_LOCAL, .offset = 0, .index = 1},
+		(instruction_t){BC_DROP},  // from implicit begin
+		// let*: reuses the slots of the first block, b is bound to a
+		(instruction_t){BC_LOAD_NUM, .num = 2},
+		(instruction_t){BC_STORE_LOCAL, .offset = 0, .index = 0},
+		(instruction_t){BC_DROP},
+		(instruction_t){BC_LOAD_LOCAL, .offset = 0, .index = 0},
+		(instruction_t){BC_STORE_LOCAL, .offset = 0, .index = 1},
+		(instruction_t){BC_DROP},
+		(instruction_t){BC_LOAD_LOCAL, .offset = 0, .index = 1},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	});
+	test(rl->cl->comp_data->var_count == 2, "let blocks should reuse local slots, expected 2 locals, got %zu", rl->cl->comp_data->var_count);
+	
+	// A slot captured by a lambda is not reused and the binding creates a new box
+	rl = test_sample("(lambda () (let ((a 1)) (lambda () a)) (let ((b 2)) b))", (instruction_t[]){
+		(instruction_t){BC_LOAD_NIL},
+		(instruction_t){BC_BOX_LOCAL, .offset = 0, .index = 0},
+		(instruction_t){BC_DROP},
+		(instruction_t){BC_LOAD_NUM, .num = 1},
+		(instruction_t){BC_BOX_LOCAL, .offset = 0, .index = 0},
+		(instruction_t){BC_DROP},
+		(instruction_t){BC_LOAD_LAMBDA, .offset = 0, .index = 0},
+		(instruction_t){BC_DROP},  // from implicit begin
+		(instruction_t){BC_LOAD_NUM, .num = 2},
+		(instruction_t){BC_STORE_LOCAL, .offset = 0, .index = 1},
+		(instruction_t){BC_DROP},
+		(instruction_t){BC_LOAD_LOCAL, .offset = 0, .index = 1},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	});
+	test(rl->cl->comp_data->var_count == 2, "captured let slots should not be reused, expected 2 locals, got %zu", rl->cl->comp_data->var_count);
+}
+
+// Returns true if the BC_GUARD_INLINED at `index` lets the inlined code run
+bool guard_passes(atom_t *rl, size_t index){
+	compiler_data_t cd = rl->cl->comp_data;
+	int64_t guard = cd->literal_table.atoms[cd->bytecode.code[index].index]->num;
+	return env->bindings[guard >> 32].version == (uint32_t)guard;
+}
+
+void test_inlining(){
+	scanner_t scan = scan_open_string("(define inline_inc (lambda (x) (+ x 1)))");
+	eval_atom(read_atom(&scan), env);
+	scan_close(&scan);
+	
+	atom_t *rl = test_sample("(lambda (y) (inline_inc y))", (instruction_t[]){
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
+		(instruction_t){BC_STORE_LOCAL, .offset = 0, .index = 0},
+		(instruction_t){BC_DROP},
+		(instruction_t){BC_GUARD_INLINED, .offset = 4},
+			// inlined body
+			(instruction_t){BC_LOAD_LOCAL, .offset = 0, .index = 0},
+			(instruction_t){BC_LOAD_NUM, .num = 1},
+			(instruction_t){BC_ADD},
+		(instruction_t){BC_JUMP, .jump_offset = 3},
+			// normal call if inline_inc was redefined
+			(instruction_t){BC_LOAD_ENV, .offset = 0, .index = 0},
+			(instruction_t){BC_LOAD_LOCAL, .offset = 0, .index = 0},
+			(instruction_t){BC_CALL, .num = 1},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	});
+	
+	// The guard only depends on the binding of inline_inc
+	test(guard_passes(rl, 3), "the guard should pass right after inlining");
+	scan = scan_open_string("(define other_lambda (lambda (x) x))");
+	eval_atom(read_atom(&scan), env);
+	scan_close(&scan);
+	scan = scan_open_string("(define other_lambda (lambda (x) (+ x 1)))");
+	eval_atom(read_atom(&scan), env);
+	scan_close(&scan);
+	test(guard_passes(rl, 3), "redefining other lambdas should not affect the guard");
+	scan = scan_open_string("(define inline_inc (lambda (x) (+ x 2)))");
+	eval_atom(read_atom(&scan), env);
+	scan_close(&scan);
+	test(!guard_passes(rl, 3), "redefining inline_inc should make the guard fail");
+	
+	// Lambdas with locals are not inlined
+	scan = scan_open_string("(define not_inlined (lambda (x) (define y x) y))");
+	eval_atom(read_atom(&scan), env);
+	scan_close(&scan);
+	
+	test_sample("(lambda (y) (not_inlined y))", (instruction_t[]){
+		(instruction_t){BC_LOAD_ENV, .offset = 0, .index = 0},
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
+		(instruction_t){BC_CALL, .num = 1},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	});
+}
+
+void test_vectors(){
+	test_sample("(lambda (v i) (vector-set! v i (vector-ref v 0)))", (instruction_t[]){
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 1},
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
+		(instruction_t){BC_LOAD_NUM, .num = 0},
+		(instruction_t){BC_VREF},
+		(instruction_t){BC_VSET},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	});
+}
+
 void test_math(){
-	// TODO
+	test_sample("(lambda (a b c) (+ a b c))", (instruction_t[]){
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 1},
+		(instruction_t){BC_ADD},
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 2},
+		(instruction_t){BC_ADD},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	});
+	test_sample("(lambda (a) (- a))", (instruction_t[]){
+		(instruction_t){BC_LOAD_NUM, .num = 0},
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
+		(instruction_t){BC_SUB},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	});
+	test_sample("(lambda (a) (* a))", (instruction_t[]){
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	});
 }
 
 void test_comparators(){
-	// TODO
+	test_sample("(lambda (a b c) (< a b c))", (instruction_t[]){
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 1},
+		(instruction_t){BC_STORE_LOCAL, .offset = 0, .index = 0},
+		(instruction_t){BC_LT},
+		(instruction_t){BC_JUMP_IF_FALSE, .jump_offset = 4},
+		(instruction_t){BC_LOAD_LOCAL, .offset = 0, .index = 0},
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 2},
+		(instruction_t){BC_LT},
+		(instruction_t){BC_JUMP, .jump_offset = 1},
+		(instruction_t){BC_LOAD_FALSE},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	});
 }
 
 int main(){
@@ -307,6 +528,11 @@ int main(){
 	
 	test_quote();
 	test_if();
+	test_constant_folding();
+	test_while();
+	test_let();
+	test_inlining();
+	test_vectors();
 	test_math();
 	test_comparators();
 	
@@ -4,6 +4,7 @@
 #include "test_bytecode_utils.h"
 
 #include "../memory.h"
+#include "../logger.h"
 #include "../reader.h"
 #include "../printer.h"
 #include "../eval.h"
@@ -36,6 +37,12 @@ static void test_sample(char *lisp_code, const char *expected_lisp_output){
 	os_clear(&os);
 }
 
+// Evaluates code directly in the global env, e.g. to define compiled lambdas there
+static void eval_global(char *code){
+	scanner_t scan = scan_open_string(code);
+	eval_atom(read_atom(&scan), env);
+	scan_close(&scan);
+}
 
 int main(){
 	memory_init();
@@ -56,6 +63,193 @@ int main(){
 	(fac 7) \
 	)", "5040");
 	
+	// Numbers switch to bignums on overflow
+	test_sample("(begin \
+	(define fac (lambda (n) (if (= n 1) 1 (* n (fac (- n 1)))))) \
+	(fac 25) \
+	)", "15511210043330985984000000");
+	
+	// Vectors
+	test_sample("(begin \
+	(define v (make-vector 10 0)) \
+	(define i 0) \
+	(while (< i 10) (vector-set! v i (* i i)) (set! i (+ i 1))) \
+	(cons (vector-ref v 9) (vector-length v)) \
+	)", "(81 . 10)");
+	// Values passed to buildins through BC_CALL must not be evaled a second time
+	test_sample("(make-vector 2 '(1 2))", "#((1 2) (1 2))");
+	
+	// Varargs and apply, the rest list is only built when the lambda uses it
+	test_sample("(begin \
+	(define ignore-rest (lambda (a . rest) a)) \
+	(define count-rest (lambda (a . rest) (length rest))) \
+	(define sum (lambda numbers (reduce + 0 numbers))) \
+	(define dispatch (lambda (op . args) (apply op args))) \
+	(define list (lambda items items)) \
+	(list (ignore-rest 1 2 3) (count-rest 1 2 3) (sum 1 2 3 4) (dispatch sum 5 6) (apply count-rest 1 '(2 3 4)) (dispatch cons 1 2)) \
+	)", "(1 2 10 11 3 (1 . 2))");
+	// Too few args for a rest parameter result in nil, like in the interpreted mode
+	test_sample("(begin \
+	(define needs-two (lambda (a b . rest) (cons a rest))) \
+	(define call-with-one (lambda (f) (f 1))) \
+	(cons (call-with-one needs-two) (cons (apply needs-two '(1)) (needs-two 1 2 3))) \
+	)", "(nil nil 1 3)");
+	
+	// Compiled lambdas running on worker threads, the futures are touched from compiled code
+	test_sample("(begin \
+	(define fib (lambda (n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))) \
+	(define pfib (lambda (n) (let ((a (future fib (- n 1))) (b (fib (- n 2)))) (+ (touch a) b)))) \
+	(cons (pfib 20) (reduce + 0 (pmap fib '(1 2 3 4 5 6 7 8 9 10 11 12 13 14 15)))) \
+	)", "(6765 . 1596)");
+	
+	// Native list functions calling compiled lambdas and buildins
+	test_sample("(begin \
+	(define offset 10) \
+	(define squares (map (lambda (x) (+ offset (* x x))) '(1 2 3 4))) \
+	(define total (reduce (lambda (sum x) (+ sum x)) 0 (filter (lambda (x) (> x 12)) squares))) \
+	(cons total (append (reverse squares) (map first '((a b) (c d))))) \
+	)", "(59 26 19 14 11 a c)");
+	
+	// Sorting with a compiled comparator
+	test_sample("(begin \
+	(define records (map (lambda (i) (cons (% (* i 37) 100) i)) (reverse '(0 1 2 3 4 5 6 7 8 9)))) \
+	(define by-key (sort records (lambda (a b) (< (first a) (first b))))) \
+	(map rest by-key) \
+	)", "(0 3 6 9 1 4 7 2 5 8)");
+	
+	// Hash tables
+	test_sample("(begin \
+	(define h (make-hash)) \
+	(define i 0) \
+	(while (< i 100) (hash-put! h i (* i 2)) (set! i (+ i 1))) \
+	(hash-put! h 'sym \"value\") \
+	(cons (hash-get h 42) (hash-get h 'sym)) \
+	)", "(84 . \"value\")");
+	
+	// Strings
+	test_sample("(begin \
+	(define b (make-string-builder)) \
+	(define i 0) \
+	(while (< i 100) (string-builder-append! b (substring \"0123456789\" (% i 10) (+ (% i 10) 1))) (set! i (+ i 1))) \
+	(define s (string-builder->string b)) \
+	(cons (string-length s) (string-append (substring s 8 12) \"!\")) \
+	)", "(100 . \"8901!\")");
+	
+	// Typed arrays
+	test_sample("(begin \
+	(define a (make-array 'i64 100)) \
+	(define i 0) \
+	(while (< i 100) (array-set! a i (- i 50)) (set! i (+ i 1))) \
+	(cons (array-sum (array-mul a a)) (array-length (array-filter a < 0))) \
+	)", "(83350 . 50)");
+	
+	// Byte buffers and files
+	test_sample("(begin \
+	(define buf (make-array 'u8 8)) \
+	(buffer-set! buf 0 'u32le 1000000) \
+	(buffer-set! buf 4 'i32be (- 7)) \
+	(write-file \"/tmp/bytecode_execution_test.bin\" buf) \
+	(define read (read-file \"/tmp/bytecode_execution_test.bin\")) \
+	(cons (buffer-ref read 0 'u32le) (buffer-ref read 4 'i32be)) \
+	)", "(1000000 . -7)");
+	
+	// Mixed integer and float arithmetic
+	test_sample("(begin \
+	(define average (lambda (a b) (/ (+ a b) 2.0))) \
+	(average 1 (average 2 2.5)) \
+	)", "1.625");
+	
+	// Variadic arithmetic and comparisons
+	test_sample("(begin \
+	(define x 3) \
+	(if (< 1 x 5) (+ x x x (- x) (* 2 x 2) (/ 120 x 2)) false) \
+	)", "38");
+	test_sample("(begin \
+	(define x 3) \
+	(= x 3 4 (/ 1 0)) \
+	)", "false");
+	
+	// Loops run with backward jumps in the same frame
+	test_sample("(begin \
+	(define i 0) \
+	(define sum 0) \
+	(while (< i 100) \
+		(set! i (+ i 1)) \
+		(set! sum (+ sum i)) \
+	) \
+	sum \
+	)", "5050");
+	
+	// let blocks shadow outer bindings and each binding gets its own box when captured
+	test_sample("(begin \
+	(define x 1) \
+	(define fs nil) \
+	(let ((x 10) (y x)) \
+		(set! fs (cons (lambda () (+ x y)) fs)) \
+	) \
+	(let* ((x 20) (y x)) \
+		(set! fs (cons (lambda () (+ x y)) fs)) \
+	) \
+	(+ x (+ ((first fs)) ((first (rest fs))))) \
+	)", "52");
+	
+	// The hidden temporary of the chained comparison must not share its slot with the captured
+	// let binding. Otherwise each loop iteration overwrites the box of the previous closure.
+	test_sample("(begin \
+	(define fs nil) \
+	(define i 0) \
+	(define a 1) \
+	(while (< i 3) \
+		(< a 2 3) \
+		(let ((x i)) (set! fs (cons (lambda () x) fs))) \
+		(set! i (+ i 1)) \
+	) \
+	(cons ((first fs)) (cons ((first (rest fs))) (cons ((first (rest (rest fs)))) nil))) \
+	)", "(2 1 0)");
+	
+	// Failing constant expressions are not folded, their warning only shows up when they run
+	output_stream_t log = os_new_capture(1024);
+	log_setup(LOG_WARN, &log);
+	test_sample("((lambda (x) (if (= x 0) 1 (/ 1 0))) 0)", "1");
+	test(log.buffer_ptr[0] == '\0', "the division in the branch not taken should not warn, got: %s", log.buffer_ptr);
+	test_sample("((lambda (x) (if (= x 0) 1 (/ 1 0))) 1)", "nil");
+	test(strstr(log.buffer_ptr, "division by zero") != NULL, "the division should warn when it runs, got: %s", log.buffer_ptr);
+	log_setup(0, NULL);
+	os_destroy(&log);
+	
+	// Calls inlined into an inlined lambda keep their guards. The lambdas are defined one by one in
+	// the global env so the callees are already bound when the callers are compiled.
+	env_def(env, "__compile_lambdas", true_atom());
+	eval_global("(define nested_f (lambda () 1))");
+	eval_global("(define nested_g (lambda () (nested_f)))");
+	eval_global("(define nested_h (lambda () (nested_g)))");
+	test_sample("(nested_h)", "1");
+	eval_global("(define nested_f (lambda () 2))");
+	test_sample("(cons (nested_g) (nested_h))", "(2 . 2)");
+	env_def(env, "__compile_lambdas", false_atom());
+	
+	// Closures share captured variables, set! in one call is visible in the next
+	test_sample("(begin \
+	(define make_counter (lambda () \
+		(define count 0) \
+		(lambda () (set! count (+ count 1))) \
+	)) \
+	(define counter (make_counter)) \
+	(counter) \
+	(counter) \
+	(counter) \
+	)", "3");
+	
+	// Each closure gets its own copy of captured arguments
+	test_sample("(begin \
+	(define make_adder (lambda (a) \
+		(lambda (b) (+ a b)) \
+	)) \
+	(define add2 (make_adder 2)) \
+	(define add5 (make_adder 5)) \
+	(+ (add2 1) (add5 1)) \
+	)", "9");
+	
 	os_destroy(&os);
 	bci_destroy(interpreter);
 	
@@ -252,7 +252,7 @@ void test_function_calls(){
 	}, 1, 0);
 	// Patch the compiled lambda itself into its own literal table at index 0.
 	// This allows the recursive call on itself.
-	fac->literal_table.atoms[0] = fac;
+	fac->comp_data->literal_table.atoms[0] = fac;
 	
 	test_compiled_sample(fac, pair_atom_alloc(num_atom_alloc(2), nil_atom()), num_atom_alloc(2));
 	test_compiled_sample(fac, pair_atom_alloc(num_atom_alloc(4), nil_atom()), num_atom_alloc(24));
@@ -507,6 +507,58 @@ void test_capturing(){
 	test_compiled_sample(test, nil_atom(), num_atom_alloc(12));
 }
 
+void test_frame_capturing(){
+	// Lambda that only uses its own frame. It doesn't need the frame it's created in.
+	atom_t *ret_own_arg = compiled((instruction_t[]){
+		(instruction_t){BC_LOAD_ARG, .offset = 0, .index = 0},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	}, NULL, 1, 0);
+	// Lambda that reaches into the frame it's created in
+	atom_t *ret_outer_local = compiled((instruction_t[]){
+		(instruction_t){BC_LOAD_LOCAL, .offset = 1, .index = 0},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	}, NULL, 0, 0);
+	test(ret_own_arg->comp_data->max_frame_offset == 0, "max_frame_offset of a lambda without outer access should be 0, got %zu",
+		ret_own_arg->comp_data->max_frame_offset);
+	test(ret_outer_local->comp_data->max_frame_offset == 1, "max_frame_offset of a lambda with outer access should be 1, got %zu",
+		ret_outer_local->comp_data->max_frame_offset);
+	
+	// Both outer lambdas return the lambda they created
+	atom_t *create_ret_own_arg = compiled((instruction_t[]){
+		(instruction_t){BC_LOAD_LAMBDA, .offset = 0, .index = 0},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	}, (atom_t*[]){
+		ret_own_arg,
+		NULL
+	}, 0, 1);
+	atom_t *create_ret_outer_local = compiled((instruction_t[]){
+		(instruction_t){BC_LOAD_LAMBDA, .offset = 0, .index = 0},
+		(instruction_t){BC_RETURN},
+		(instruction_t){BC_NULL}
+	}, (atom_t*[]){
+		ret_outer_local,
+		NULL
+	}, 0, 1);
+	test(create_ret_own_arg->comp_data->max_frame_offset == 0, "max_frame_offset of nested lambdas should be reduced by one, got %zu",
+		create_ret_own_arg->comp_data->max_frame_offset);
+	test(create_ret_outer_local->comp_data->max_frame_offset == 0, "max_frame_offset of nested lambdas should be reduced by one, got %zu",
+		create_ret_outer_local->comp_data->max_frame_offset);
+	
+	atom_t *rl = bci_eval(interpreter, runtime_lambda_atom_alloc(create_ret_own_arg, scope_env_alloc(env)), nil_atom(), env);
+	test(rl->type == T_RUNTIME_LAMBDA, "expected a runtime lambda, got type %d", rl->type);
+	test(rl->scopes->type == SCOPE_ENV, "a lambda without outer access should not capture the frame it was created in");
+	
+	rl = bci_eval(interpreter, runtime_lambda_atom_alloc(create_ret_outer_local, scope_env_alloc(env)), nil_atom(), env);
+	test(rl->type == T_RUNTIME_LAMBDA, "expected a runtime lambda, got type %d", rl->type);
+	test(rl->scopes->type == SCOPE_HEAP, "the frame a lambda reaches into should be captured on return");
+	test(rl->scopes->depth == 1 && rl->scopes->display[0] == rl->scopes && rl->scopes->display[1]->type == SCOPE_ENV,
+		"the display of the captured frame should contain the frame and the env scope");
+	test(interpreter->stack->length == 0, "the stack was not empty after execution, %d atoms left", interpreter->stack->length);
+}
+
 int main(){
 	memory_init();
 	env = env_alloc(NULL);
@@ -528,6 +580,7 @@ int main(){
 	
 	test_pair_instructions();
 	test_capturing();
+	test_frame_capturing();
 	
 	bci_destroy(interpreter);
 	return show_test_report();
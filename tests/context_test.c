@@ -0,0 +1,142 @@
+#include <pthread.h>
+
+#include "test_utils.h"
+#include "../context.h"
+
+void test_isolation(){
+	lisp_context_t *a = context_new(true);
+	lisp_context_t *b = context_new(true);
+	
+	context_enter(a);
+	context_eval_str(a, "(define x 1) (define get-x (lambda () x))");
+	lisp_context_t *previous = context_enter(b);
+	test(previous == a && context_current() == b, "context_enter() should return the previous context");
+	context_eval_str(b, "(define x 2)");
+	
+	atom_t *result = context_eval_str(b, "x");
+	test(result->type == T_NUM && result->num == 2, "expected x to be 2 in context b");
+	result = context_eval_str(b, "get-x");
+	test(result->type == T_NIL, "get-x of context a should not be visible in context b");
+	
+	context_leave(previous);
+	test(context_current() == a, "context_leave() should restore the previous context");
+	result = context_eval_str(a, "(get-x)");
+	test(result->type == T_NUM && result->num == 1, "expected x to be 1 in context a");
+	
+	context_leave(NULL);
+	test(context_current() == NULL, "the thread should not have a context after leaving the last one");
+	test(context_destroy(a) == true, "destroying a context no thread is in should work");
+	test(context_destroy(b) == true, "destroying a context no thread is in should work");
+}
+
+
+// A thread that enters a context and stays in it until it's told to leave
+typedef struct {
+	lisp_context_t *context;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool entered, should_leave;
+} holder_t;
+
+void* run_holder(void *arg){
+	holder_t *holder = arg;
+	context_enter(holder->context);
+	
+	pthread_mutex_lock(&holder->mutex);
+	holder->entered = true;
+	pthread_cond_broadcast(&holder->cond);
+	while (!holder->should_leave)
+		pthread_cond_wait(&holder->cond, &holder->mutex);
+	pthread_mutex_unlock(&holder->mutex);
+	
+	context_leave(NULL);
+	return NULL;
+}
+
+void test_destroy_while_entered(){
+	holder_t holder = { .context = context_new(true), .mutex = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER, .entered = false, .should_leave = false };
+	pthread_t thread;
+	pthread_create(&thread, NULL, run_holder, &holder);
+	
+	pthread_mutex_lock(&holder.mutex);
+	while (!holder.entered)
+		pthread_cond_wait(&holder.cond, &holder.mutex);
+	pthread_mutex_unlock(&holder.mutex);
+	test(context_destroy(holder.context) == false, "a context entered by another thread must not be destroyed");
+	
+	pthread_mutex_lock(&holder.mutex);
+	holder.should_leave = true;
+	pthread_cond_broadcast(&holder.cond);
+	pthread_mutex_unlock(&holder.mutex);
+	pthread_join(thread, NULL);
+	test(context_destroy(holder.context) == true, "the context should be destroyed after the thread left it");
+	
+	// The contexts of the calling thread have to be left first, destroying doesn't leave them
+	lisp_context_t *outer = context_new(true), *inner = context_new(true);
+	context_enter(outer);
+	lisp_context_t *previous = context_enter(inner);
+	test(context_destroy(outer) == false, "a context below the current one must not be destroyed");
+	test(context_destroy(inner) == false, "the current context must not be destroyed");
+	test(context_current() == inner, "a refused context_destroy() should not change the current context");
+	context_leave(previous);
+	test(context_current() == outer, "leaving the inner context should restore the outer one");
+	test(context_destroy(inner) == true, "a left context should be destroyed");
+	test(context_destroy(outer) == false, "the current context must not be destroyed");
+	context_leave(NULL);
+	test(context_destroy(outer) == true, "the outer context should be destroyed after leaving it");
+	test(context_current() == NULL, "the thread should not have a context after leaving all of them");
+}
+
+
+// Each thread defines a different offset in its own context and then runs compiled code
+typedef struct {
+	int64_t offset;
+	atom_t *result;
+} worker_t;
+
+void* run_worker(void *arg){
+	worker_t *worker = arg;
+	lisp_context_t *context = context_new(true);
+	context_enter(context);
+	
+	env_def(context->env, "offset", num_atom_alloc(worker->offset));
+	worker->result = context_eval_str(context, "(begin \
+		(define fib (lambda (n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))) \
+		(define add-offset (lambda (n) (+ n offset))) \
+		(reduce + 0 (map add-offset (map fib '(10 15 20)))) \
+	)");
+	
+	context_leave(NULL);
+	context_destroy(context);
+	return NULL;
+}
+
+void test_threads(){
+	const size_t thread_count = 4;
+	pthread_t threads[thread_count];
+	worker_t workers[thread_count];
+	
+	for(size_t i = 0; i < thread_count; i++){
+		workers[i] = (worker_t){ .offset = i * 1000, .result = NULL };
+		pthread_create(&threads[i], NULL, run_worker, &workers[i]);
+	}
+	
+	for(size_t i = 0; i < thread_count; i++){
+		pthread_join(threads[i], NULL);
+		// fib(10) + fib(15) + fib(20) = 55 + 610 + 6765
+		int64_t expected = 7430 + 3 * workers[i].offset;
+		test(workers[i].result != NULL && workers[i].result->type == T_NUM && workers[i].result->num == expected,
+			"thread %zu: expected %ld", i, expected);
+	}
+}
+
+
+int main(){
+	memory_init();
+	
+	test_isolation();
+	test_threads();
+	test_destroy_while_entered();
+	
+	return show_test_report();
+}
\ No newline at end of file
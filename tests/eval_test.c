@@ -5,6 +5,7 @@
 #include "../reader.h"
 #include "../printer.h"
 #include "../buildins.h"
+#include "../bytecode_interpreter.h"
 
 void test_env_get_and_set(){
 	env_t *env = env_alloc(NULL);
@@ -93,6 +94,15 @@ char *language_buildin_samples[] = {
 	"true_case_evaled", "false",
 	"false_case_evaled", "true",
 	
+	"(define loop_counter 0)", "0",
+	"(while (< loop_counter 3) (set! loop_counter (+ loop_counter 1)))", "nil",
+	"loop_counter", "3",
+	
+	"(define let_var 1)", "1",
+	"(let ((let_var 2) (other let_var)) other)", "1",
+	"(let* ((let_var 2) (other let_var)) other)", "2",
+	"let_var", "1",
+	
 	"(define foo (lambda (a b) b))", "(lambda (a b) b)",
 	"(foo 1 2)", "2",
 	"(define implicit_begin_foo (lambda (a b) a a b))", "(lambda (a b) (begin a a b))",
@@ -134,6 +144,91 @@ void test_eval_with_buildins(){
 		"\"hello\"", "\"hello\"",
 		
 		"(+ 1 2)", "3",
+		"(+)", "0",
+		"(+ 1 2 3 4)", "10",
+		"(- 5)", "-5",
+		"(- 10 1 2)", "7",
+		"(* 2 3 4)", "24",
+		"(/ 100 5 2)", "10",
+		"(< 1 2 3)", "true",
+		"(< 1 3 2)", "false",
+		"(= 2 2 2)", "true",
+		"(> 3 2 1)", "true",
+		"(* 4294967296 4294967296)", "18446744073709551616",
+		"(- 18446744073709551616 18446744073709551615)", "1",
+		"(< 9223372036854775807 9223372036854775808)", "true",
+		"(% 18446744073709551617 4294967296)", "1",
+		"((lambda (a . rest) (cons a rest)) 1 2 3)", "(1 2 3)",
+		"((lambda (a . rest) rest) 1)", "nil",
+		"((lambda (a b . rest) (cons a rest)) 1)", "nil",
+		"(apply (lambda (a b . rest) (cons a rest)) '(1))", "nil",
+		"((lambda args args) 1 2)", "(1 2)",
+		"((lambda (a . rest) a) 1 2 3)", "1",
+		"(apply + 1 2 '(3 4))", "10",
+		"(apply (lambda (a . rest) (cons a rest)) '(1 2))", "(1 2)",
+		"(apply cons '(1 2))", "(1 . 2)",
+		"(begin (define n 0) (apply (lambda args args) (set! n (+ n 1)) (set! n (+ n 1)) (cons (set! n (+ n 1)) nil)))", "(1 2 3)",
+		"(pmap (lambda (x) (* x x)) '(1 2 3 4 5))", "(1 4 9 16 25)",
+		"(pmap first (make-vector 2 '(1 2)))", "#(1 1)",
+		"(pmap first nil)", "nil",
+		"(touch (future + 1 2 3))", "6",
+		"(await (future (lambda (a . rest) (cons a rest)) 1 2))", "(1 2)",
+		"(touch 5)", "5",
+		"(map (lambda (x) (* x x)) '(1 2 3))", "(1 4 9)",
+		"(map (lambda (x) (+ x 1)) #(1 2))", "#(2 3)",
+		"(filter (lambda (x) (> x 1)) '(1 2 3))", "(2 3)",
+		"(filter (lambda (x) (> x 5)) #(1 2 3))", "#()",
+		"(reduce + 0 '(1 2 3 4))", "10",
+		"(reduce cons nil '(1 2))", "((nil . 1) . 2)",
+		"(for-each (lambda (x) x) '(1 2))", "nil",
+		"(length '(1 2 3))", "3",
+		"(length nil)", "0",
+		"(reverse '(1 2 3))", "(3 2 1)",
+		"(append '(1 2) nil '(3) '(4 5))", "(1 2 3 4 5)",
+		"(append)", "nil",
+		"(sort '(3 1 2))", "(1 2 3)",
+		"(sort #(2.5 1 18446744073709551616 0.5))", "#(0.5 1 2.5 18446744073709551616)",
+		"(sort '(\"b\" \"ab\" \"a\"))", "(\"a\" \"ab\" \"b\")",
+		"(sort '(1 2 3) >)", "(3 2 1)",
+		"(sort '((2 . a) (1 . b) (2 . c) (1 . d)) (lambda (x y) (< (first x) (first y))))", "((1 . b) (1 . d) (2 . a) (2 . c))",
+		"(sort '(1 a))", "nil",
+		"(vector-ref #(1 2 3) 1)", "2",
+		"(vector-length (make-vector 3 0))", "3",
+		"(make-vector 2)", "#(nil nil)",
+		"(begin (define vec (make-vector 2 0)) (vector-set! vec 1 5) vec)", "#(0 5)",
+		"(vector-ref #(1 2 3) 3)", "nil",
+		"(begin (define h (make-hash)) (hash-put! h 'a 1) (hash-put! h \"b\" 2) (+ (hash-get h 'a) (hash-get h \"b\")))", "3",
+		"(hash-get h 'c 42)", "42",
+		"(hash-delete! h 'a)", "true",
+		"(hash-keys h)", "(\"b\")",
+		"(hash-count h)", "1",
+		"(string-length \"hello\")", "5",
+		"(string-append \"a\" \"bc\" \"\" \"d\")", "\"abcd\"",
+		"(string-append)", "\"\"",
+		"(substring \"hello world\" 6)", "\"world\"",
+		"(substring \"hello world\" 1 4)", "\"ell\"",
+		"(substring \"hello\" 3 9)", "nil",
+		"(string-builder->string (string-builder-append! (make-string-builder) \"x\" \"y\"))", "\"xy\"",
+		"(begin (define buf (string->buffer \"abcd\")) (buffer-ref buf 0 'u16be))", "24930",
+		"(buffer-set! buf 2 'i16le (- 1))", "-1",
+		"(buffer->string buf 0 2)", "\"ab\"",
+		"(buffer-ref buf 2 'u8)", "255",
+		"(buffer-ref buf 3 'u16le)", "nil",
+		"(make-array 'i64 3 7)", "#i64(7 7 7)",
+		"(begin (define arr (make-array 'f64 4)) (array-set! arr 0 1.5) (array-set! arr 3 2) (array-ref arr 3))", "2.0",
+		"(array-sum (array-add arr arr))", "7.0",
+		"(array-dot arr arr)", "6.25",
+		"(array-filter arr > 1.8)", "#f64(2.0)",
+		"(array-max (make-array 'u8 3 200))", "200",
+		"(array-set! (make-array 'u8 1) 0 256)", "nil",
+		"(+ 1 0.5)", "1.5",
+		"(* 2.0 3)", "6.0",
+		"(/ 1.0 4)", "0.25",
+		"(- 0.5)", "-0.5",
+		"(% 7.5 2)", "1.5",
+		"(= 1 1.0)", "true",
+		"(< 1 1.5 2)", "true",
+		"(> 18446744073709551616 1.5)", "true",
 		
 		"(define simple_val 123)", "123",
 		"simple_val", "123",
@@ -167,6 +262,100 @@ void test_eval_with_buildins(){
 	os_destroy(&os);
 }
 
+void test_eval_of_compiled_lambdas(){
+	output_stream_t os = os_new_capture(4096);
+	env_t *env = env_alloc(NULL);
+	register_buildins_in(env);
+	env_def(env, "__compile_lambdas", true_atom());
+	
+	char *samples[] = {
+		"(define inc (lambda (x) (+ x 1)))", NULL,
+		"(inc 1)", "2",
+		"(inc (inc 1))", "3",
+		"(define twice (lambda (f x) (f (f x))))", NULL,
+		"(twice inc 5)", "7",
+		"(inc 1 2)", "nil",
+		// inc is inlined into call_inc, redefining inc has to switch it to a normal call
+		"(define call_inc (lambda (x) (inc x)))", NULL,
+		"(call_inc 1)", "2",
+		"(define inc (lambda (x) (+ x 10)))", NULL,
+		"(call_inc 1)", "11",
+		"(inc 1)", "11",
+		NULL
+	};
+	
+	for(size_t i = 0; samples[i] != NULL; i += 2){
+		scanner_t scan = scan_open_string(samples[i]);
+		atom_t *atom = eval_atom(read_atom(&scan), env);
+		scan_close(&scan);
+		
+		if (samples[i+1] != NULL) {
+			print_atom(&os, atom);
+			test(strcmp(os.buffer_ptr, samples[i+1]) == 0, "unexpected eval output.\ninput: %s\noutput: %s\nexpected: %s", samples[i], os.buffer_ptr, samples[i+1]);
+			os_clear(&os);
+		}
+		
+		test(bci_current()->stack->length == 0, "the shared interpreter stack should be empty after %s, got %zu atoms",
+			samples[i], bci_current()->stack->length);
+	}
+	
+	os_destroy(&os);
+}
+
+
+/**
+ * Buildins called with already evaluated values (by map or compiled code) must get these values
+ * without an env lookup. So they still work when quote is rebound.
+ */
+void test_buildin_calls_with_values(){
+	output_stream_t os = os_new_capture(4096);
+	env_t *env = env_alloc(NULL);
+	register_buildins_in(env);
+	env_def(env, "__compile_lambdas", true_atom());
+	
+	char *samples[] = {
+		"(define lists '((1 2) (3 4)))", NULL,
+		"(define first-of (lambda (l) (first l)))", NULL,
+		"(define quote 1)", NULL,
+		"(map first lists)", "(1 3)",
+		"(first-of (first lists))", "1",
+		"(reduce cons nil lists)", "((nil 1 2) 3 4)",
+		NULL
+	};
+	
+	for(size_t i = 0; samples[i] != NULL; i += 2){
+		scanner_t scan = scan_open_string(samples[i]);
+		atom_t *atom = eval_atom(read_atom(&scan), env);
+		scan_close(&scan);
+		
+		if (samples[i+1] != NULL) {
+			print_atom(&os, atom);
+			test(strcmp(os.buffer_ptr, samples[i+1]) == 0, "unexpected eval output.\ninput: %s\noutput: %s\nexpected: %s", samples[i], os.buffer_ptr, samples[i+1]);
+			os_clear(&os);
+		}
+	}
+	
+	os_destroy(&os);
+}
+
+/**
+ * apply must not put the elements of long lists on the C stack.
+ */
+void test_apply_with_long_list(){
+	env_t *env = env_alloc(NULL);
+	register_buildins_in(env);
+	
+	const size_t length = 2000000;
+	atom_t *list = nil_atom();
+	for(size_t i = 0; i < length; i++)
+		list = pair_atom_alloc(num_atom_alloc(1), list);
+	env_def(env, "long-list", list);
+	
+	scanner_t scan = scan_open_string("(apply + long-list)");
+	atom_t *result = eval_atom(read_atom(&scan), env);
+	scan_close(&scan);
+	test(result->type == T_NUM && result->num == (int64_t)length, "expected the sum of %zu ones", length);
+}
 
 int main(){
 	// Important for singleton atoms (nil, true, false). Otherwise we got NULL pointers there...
@@ -176,5 +365,8 @@ int main(){
 	test_nested_env();
 	test_eval_lowlevel();
 	test_eval_with_buildins();
+	test_eval_of_compiled_lambdas();
+	test_buildin_calls_with_values();
+	test_apply_with_long_list();
 	return show_test_report();
 }
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include <string.h>
+
+#include "test_utils.h"
+#include "../hash.h"
+
+void test_put_and_get(){
+	hash_t *hash = hash_new(0);
+	
+	hash_put(hash, num_atom_alloc(1), str_atom_alloc("one"));
+	hash_put(hash, str_atom_alloc("two"), num_atom_alloc(2));
+	hash_put(hash, sym_atom_alloc("three"), num_atom_alloc(3));
+	test(hash->length == 3, "expected 3 entries, got %zu", hash->length);
+	
+	// Keys are compared by value, not by identity
+	atom_t *value = hash_get(hash, num_atom_alloc(1));
+	test(value != NULL && strcmp(value->str, "one") == 0, "lookup of a number key failed");
+	value = hash_get(hash, str_atom_alloc("two"));
+	test(value != NULL && value->num == 2, "lookup of a string key failed");
+	value = hash_get(hash, sym_atom_alloc("three"));
+	test(value != NULL && value->num == 3, "lookup of a symbol key failed");
+	
+	test(hash_get(hash, sym_atom_alloc("two")) == NULL, "a symbol should not find a string key");
+	test(hash_get(hash, float_atom_alloc(1.0)) == NULL, "a float should not find an integer key");
+	
+	// Other atoms are compared by identity
+	atom_t *pair = pair_atom_alloc(nil_atom(), nil_atom());
+	hash_put(hash, pair, true_atom());
+	test(hash_get(hash, pair) == true_atom(), "lookup of a pair key failed");
+	test(hash_get(hash, pair_atom_alloc(nil_atom(), nil_atom())) == NULL, "pairs should be compared by identity");
+	
+	// Putting an existing key replaces the value
+	hash_put(hash, num_atom_alloc(1), false_atom());
+	test(hash_get(hash, num_atom_alloc(1)) == false_atom() && hash->length == 4, "replacing a value failed");
+}
+
+void test_growing(){
+	hash_t *hash = hash_new(0);
+	
+	for(int64_t i = 0; i < 1000; i++)
+		hash_put(hash, num_atom_alloc(i), num_atom_alloc(i * i));
+	test(hash->length == 1000, "expected 1000 entries, got %zu", hash->length);
+	test(hash->length * 4 <= hash->capacity * 3, "load factor too high: %zu entries in %zu slots", hash->length, hash->capacity);
+	
+	bool all_found = true;
+	for(int64_t i = 0; i < 1000; i++){
+		atom_t *value = hash_get(hash, num_atom_alloc(i));
+		if (value == NULL || value->num != i * i)
+			all_found = false;
+	}
+	test(all_found, "not all entries were found after growing the table");
+}
+
+void test_delete(){
+	hash_t *hash = hash_new(0);
+	
+	for(int64_t i = 0; i < 6; i++)
+		hash_put(hash, num_atom_alloc(i), true_atom());
+	
+	test(hash_delete(hash, num_atom_alloc(3)) == true, "delete of an existing key failed");
+	test(hash_delete(hash, num_atom_alloc(3)) == false, "delete of a missing key should return false");
+	test(hash_get(hash, num_atom_alloc(3)) == NULL && hash->length == 5, "deleted key still found");
+	test(hash_get(hash, num_atom_alloc(5)) == true_atom(), "keys after a deleted one should still be found");
+	
+	test(hash_keys(hash)->type == T_PAIR, "hash_keys() returned no keys");
+	size_t key_count = 0;
+	for(atom_t *pair = hash_keys(hash); pair->type == T_PAIR; pair = pair->rest)
+		key_count++;
+	test(key_count == 5, "expected 5 keys, got %zu", key_count);
+	
+	// Putting and deleting over and over again should get rid of the deleted slots instead of
+	// growing the table each time it's full
+	size_t capacity = hash->capacity;
+	for(int64_t i = 100; i < 1100; i++){
+		hash_put(hash, num_atom_alloc(i), true_atom());
+		hash_delete(hash, num_atom_alloc(i));
+	}
+	test(hash->capacity <= 2 * capacity && hash->length == 5, "deleted slots were not dropped, capacity grew from %zu to %zu", capacity, hash->capacity);
+}
+
+
+int main(){
+	memory_init();
+	
+	test_put_and_get();
+	test_growing();
+	test_delete();
+	
+	return show_test_report();
+}
\ No newline at end of file
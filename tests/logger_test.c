@@ -17,6 +17,14 @@ int main(){
 	error("test error: %s", "world");
 	test(strcmp(os.buffer_ptr, "[info in logger_test.c:13 main()]: test info: 123\n[warn in logger_test.c:15 main()]: test warning: 123, hello\n[ERROR in logger_test.c:17 main()]: test error: world\n") == 0, "expected the first tree log messages but got '%s'", os.buffer_ptr);
 	
+	os_clear(&os);
+	bool was_muted = log_mute(true);
+	warn("muted warning");
+	test(was_muted == false && os.buffer_ptr[0] == '\0', "muted messages should be dropped but got '%s'", os.buffer_ptr);
+	test(log_mute(was_muted) == true, "log_mute() should return the previous state");
+	warn("unmuted warning");
+	test(strstr(os.buffer_ptr, "unmuted warning") != NULL, "expected the warning after unmuting but got '%s'", os.buffer_ptr);
+	
 	os_destroy(&os);
 	return show_test_report();
 }
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include "test_utils.h"
+#include "../pool.h"
+#include "../memory.h"
+
+static int counter = 0;
+
+void increment(void *data){
+	__atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED);
+}
+
+void test_submit_and_wait(){
+	const size_t task_count = 1000;
+	pool_task_t *tasks[task_count];
+	
+	for(size_t i = 0; i < task_count; i++)
+		tasks[i] = pool_submit(increment, NULL);
+	for(size_t i = 0; i < task_count; i++)
+		pool_wait(tasks[i]);
+	
+	bool all_done = true;
+	for(size_t i = 0; i < task_count; i++)
+		all_done = all_done && pool_task_done(tasks[i]);
+	test(all_done, "all tasks should be done after waiting for them");
+	test(counter == task_count, "expected %zu increments, got %d", task_count, counter);
+}
+
+
+// Tasks that submit and wait for their own subtasks, there are far more waiting tasks than
+// workers. This only finishes if waiting threads run the queued tasks.
+typedef struct {
+	int n, result;
+} fib_t;
+
+void fib_task(void *data){
+	fib_t *fib = data;
+	if (fib->n < 2) {
+		fib->result = fib->n;
+		return;
+	}
+	
+	fib_t a = { fib->n - 1, 0 }, b = { fib->n - 2, 0 };
+	pool_task_t *task = pool_submit(fib_task, &a);
+	fib_task(&b);
+	pool_wait(task);
+	fib->result = a.result + b.result;
+}
+
+void test_nested_tasks(){
+	fib_t fib = { 18, 0 };
+	pool_task_t *task = pool_submit(fib_task, &fib);
+	pool_wait(task);
+	test(fib.result == 2584, "expected fib(18) to be 2584, got %d", fib.result);
+}
+
+
+int main(){
+	memory_init();
+	
+	test(pool_worker_count() > 0, "the pool should have at least one worker");
+	test_submit_and_wait();
+	test_nested_tasks();
+	
+	return show_test_report();
+}
\ No newline at end of file
@@ -15,6 +15,8 @@ void test_printer(){
 		"(define (plus a b) (+ a b))",
 		"(+ 1 (- 1 (* 4 5)))",
 		"'quoted",
+		"(1.5 2.0 0.1 1e+100)",
+		"#(1 (2 3) #() \"str\")",
 		NULL
 	};
 	
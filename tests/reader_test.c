@@ -22,6 +22,18 @@ void test_reader(){
 	atom = read_test_code("123");
 	test(atom->type == T_NUM && atom->num == 123, "got type: %d, num: %ld", atom->type, atom->num);
 	
+	atom = read_test_code("1.25");
+	test(atom->type == T_FLOAT && atom->real == 1.25, "got type: %d, real: %f", atom->type, atom->real);
+	
+	atom = read_test_code("5e-3");
+	test(atom->type == T_FLOAT && atom->real == 5e-3, "got type: %d, real: %f", atom->type, atom->real);
+	
+	atom = read_test_code("18446744073709551616");
+	test(atom->type == T_BIGNUM, "got type: %d", atom->type);
+	
+	atom = read_test_code("#(1 sym)");
+	test(atom->type == T_VECTOR && atom->length == 2 && atom->elements[0]->type == T_NUM && atom->elements[1]->type == T_SYM, "got type: %d", atom->type);
+	
 	atom = read_test_code("sym");
 	test(atom->type == T_SYM && strcmp(atom->sym, "sym") == 0, "got type: %d, sym: %s", atom->type, atom->sym);
 	
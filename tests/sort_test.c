@@ -0,0 +1,57 @@
+#include "test_utils.h"
+#include "../sort.h"
+
+static bool less_by_num(atom_t *a, atom_t *b, void *data){
+	(*(size_t*)data)++;
+	return a->num < b->num;
+}
+
+// Sorts pairs by their first element only so we can see if equal elements keep their order
+static bool less_by_first(atom_t *a, atom_t *b, void *data){
+	return a->first->num < b->first->num;
+}
+
+void test_sort(){
+	// Long enough for several merge passes
+	size_t length = 1000;
+	atom_t *atoms[length];
+	for(size_t i = 0; i < length; i++)
+		atoms[i] = num_atom_alloc((i * 7919) % length);
+	
+	size_t comparisons = 0;
+	sort_atoms(atoms, length, less_by_num, &comparisons);
+	bool sorted = true;
+	for(size_t i = 0; i < length; i++)
+		sorted = sorted && atoms[i]->num == (int64_t)i;
+	test(sorted, "the atoms are not sorted");
+	
+	// Sorted input only needs the insertion sort and one comparison per merge
+	comparisons = 0;
+	sort_atoms(atoms, length, less_by_num, &comparisons);
+	test(comparisons < 2 * length, "sorting sorted input took %zu comparisons", comparisons);
+}
+
+void test_stability(){
+	size_t length = 300;
+	atom_t *atoms[length];
+	for(size_t i = 0; i < length; i++)
+		atoms[i] = pair_atom_alloc(num_atom_alloc(i % 3), num_atom_alloc(i));
+	
+	sort_atoms(atoms, length, less_by_first, NULL);
+	bool stable = true;
+	for(size_t i = 1; i < length; i++){
+		if (atoms[i]->first->num == atoms[i-1]->first->num && atoms[i]->rest->num < atoms[i-1]->rest->num)
+			stable = false;
+	}
+	test(stable && atoms[0]->first->num == 0 && atoms[length-1]->first->num == 2, "equal elements changed their order");
+}
+
+
+int main(){
+	memory_init();
+	
+	test_sort();
+	test_stability();
+	
+	return show_test_report();
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#include <string.h>
+
+#include "test_utils.h"
+#include "../str.h"
+
+void test_slices(){
+	atom_t *str = str_atom_alloc("hello world");
+	test(str->str_length == 11, "expected a length of 11, got %zu", str->str_length);
+	
+	atom_t *hello = str_slice(str, 0, 5), *world = str_slice(str, 6, 11);
+	test(hello->str == str->str && hello->str_length == 5, "slices should share the buffer of the string");
+	test(str_equal(hello, str_atom_alloc("hello")), "slice compares not equal to \"hello\"");
+	test(!str_equal(hello, str_atom_alloc("hell")), "strings of different length should not be equal");
+	
+	// Only slices in the middle of a buffer need a copy to get a C string
+	test(str_to_cstr(world) == world->str, "a slice at the end of a buffer is already 0 terminated");
+	char *cstr = str_to_cstr(hello);
+	test(cstr != hello->str && strcmp(cstr, "hello") == 0, "expected a terminated copy \"hello\", got \"%s\"", cstr);
+}
+
+void test_builder(){
+	str_builder_t *builder = str_builder_new(0);
+	for(size_t i = 0; i < 1000; i++)
+		str_builder_append(builder, "abc", 3);
+	test(builder->length == 3000 && builder->capacity >= 3000, "expected 3000 bytes in the builder, got %zu", builder->length);
+	test(builder->capacity < 6000, "the builder should grow by doubling, capacity is %zu", builder->capacity);
+	
+	atom_t *str = str_builder_to_str(builder);
+	test(str->str_length == 3000 && memcmp(str->str + 2997, "abc", 3) == 0, "wrong string from the builder");
+	
+	// Appending more must not change strings taken out before
+	str_builder_append(builder, "xyz", 3);
+	atom_t *more = str_builder_to_str(builder);
+	test(str->str_length == 3000 && more->str_length == 3003, "appending changed an earlier string");
+	test(memcmp(more->str + 3000, "xyz", 3) == 0, "appended data missing");
+}
+
+
+int main(){
+	memory_init();
+	
+	test_slices();
+	test_builder();
+	
+	return show_test_report();
+}
\ No newline at end of file
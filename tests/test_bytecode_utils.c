@@ -18,9 +18,14 @@ bool test_instruction(instruction_t subject, instruction_t expected, size_t idx,
 	else if (subject.op == BC_JUMP || subject.op == BC_JUMP_IF_FALSE)
 		return test(subject.jump_offset == expected.jump_offset, "%s %zu got wrong offset, expected %d, got %d",
 			msg, idx, expected.jump_offset, subject.jump_offset);
-	else if (subject.op == BC_LOAD_LITERAL || subject.op == BC_LOAD_ARG)
+	else if (subject.op == BC_LOAD_LITERAL || subject.op == BC_LOAD_ARG || subject.op == BC_LOAD_LOCAL || subject.op == BC_STORE_LOCAL
+		|| (subject.op >= BC_LOAD_CAPTURED && subject.op <= BC_BOX_LOCAL))
 		return test(subject.offset == expected.offset && subject.index == expected.index,
-			"%s %zu got wrong offset, expected %d, got %d", msg, idx, expected.jump_offset, subject.jump_offset);
+			"%s %zu got wrong offset or index, expected %d/%d, got %d/%d", msg, idx, expected.offset, expected.index, subject.offset, subject.index);
+	else if (subject.op == BC_GUARD_INLINED)
+		// The literal with the binding version depends on the bindings defined before, only check the jump offset
+		return test(subject.offset == expected.offset, "%s %zu got wrong guard offset, expected %d, got %d",
+			msg, idx, expected.offset, subject.offset);
 	else if (subject.op == BC_CALL)
 		return test(subject.num == expected.num,
 			"%s %zu got wrong num, expected %d, got %d", msg, idx, expected.num, subject.num);